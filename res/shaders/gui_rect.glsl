@@ -62,6 +62,7 @@ in vec2 size;
 in vec3 color;
 
 uniform float radius;
+uniform float inset; // pixels left out on each side
 const float smoothing = 4;
 
 float rect(vec2 p, vec2 c, float w, float h, float r){
@@ -75,7 +76,7 @@ void main(){
     float width = size.x;
     float height = size.y;
     vec2 p = vec2(uv.x*width, uv.y*height);
-    float d = rect(p, vec2(width/2.0, height/2.0), width/2.0-1.5, height/2.0-1.5, radius);
+    float d = rect(p, vec2(width/2.0, height/2.0), width/2.0-inset, height/2.0-inset, radius);
     vec2 duv = fwidth(uv)*smoothing;
     float dd = length(duv*size);
     float pixelDist = d * 2 / dd;
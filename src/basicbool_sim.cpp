@@ -0,0 +1,654 @@
+// Headless runner : load a circuit and run it as fast as possible, no window nor OpenGL context.
+
+#include "core/defines.hpp"
+#include "node/circuit.hpp"
+#include "node/circuit_io.hpp"
+#include "node/composite.hpp"
+#include "node/nodes.hpp"
+#include "sim/aig.hpp"
+#include "sim/bitsliced.hpp"
+#include "sim/equivalence.hpp"
+#include "sim/simulator.hpp"
+#include "sim/truth_table.hpp"
+#include "sim/trace_file.hpp"
+#include "sim/vcd_writer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+static void printUsage() {
+    std::cout << "usage : basicbool-sim [options] <circuit file>\n"
+                 "  -n, --ticks <N>      number of ticks to run (default 1000)\n"
+                 "  --perf-test <N>      generate N TRUE/NOT groups instead of loading a file\n"
+                 "  --save <path>        write the circuit before running it\n"
+                 "  --engine <full|event|settle> tick engine (default full), settle uses zero delay links\n"
+                 "  --lut-inputs <N>     settle composite instances reading at most N pins (max 16, default 16)\n"
+                 "                       through a lookup table, 0 evaluates every gate\n"
+                 "  --threads <N>        threads running full engine ticks, 0 for every core (default 1)\n"
+                 "  --lookahead <N>      ticks partitions may run apart with several threads (default 8)\n"
+                 "  --lockstep           tick one at a time instead of letting partitions run ahead\n"
+                 "  --detect-cycles      find fixed points & periodic states, then skip whole periods\n"
+                 "  --history <MB>       record recent states within that much memory\n"
+                 "  --trace <path>       write the value changes of the probed connectors (every output without probes),\n"
+                 "                       as VCD for .vcd paths and as a binary trace (.bbt) otherwise\n"
+                 "  --break <expr>       stop on the tick the expression over probe names becomes true, repeatable\n"
+                 "  --trace-at <tick>    after tracing, read the binary trace back and print each signal at that tick\n"
+                 "  --lanes <64|256|512>  simulate that many random input vectors per tick (bitsliced)\n"
+                 "  --aig <path>         lower the circuit to an and-inverter graph, write it as ASCII AIGER and time it\n"
+                 "  --equiv <path>       prove the circuit computes the same outputs as another one, or show inputs where\n"
+                 "                       it doesn't (loop free circuits, inputs & outputs in node order)\n"
+                 "  --truth-table <path> enumerate every input combination and write the outputs of each (up to 24 inputs)\n"
+                 "  --truth-hash         enumerate every input combination and only print a hash of the outputs (up to\n"
+                 "                       32 inputs), both split the rows across --threads\n"
+                 "  --bench-kernels      time every gate kernel set this CPU supports\n"
+                 "  --no-optimize        simulate the compiled netlist as is, without the optimization passes\n"
+                 "  --sweep              also drop the gates no probe nor OUT node depends on\n"
+                 "  --verify             also run the reference node/link update and compare every connector\n";
+}
+
+struct Options {
+    string circuitPath;
+    string savePath;
+    long long ticks = 1000;
+    int perfTest = 0;
+    int lanes = 1;
+    int threads = 1;
+    int lookahead = 8;
+    int lutInputs = (int) SettleEngine::MAX_LUT_INPUTS;
+    bool lockstep = false;
+    bool detectCycles = false;
+    int historyMB = 0;
+    string tracePath;
+    string aigPath;
+    string equivPath;
+    string truthTablePath;
+    bool truthHash = false;
+    long long traceAt = -1;
+    std::vector<string> breakpoints;
+    EngineMode engine = EngineMode::FULL;
+    bool optimize = true;
+    bool sweep = false;
+    bool verify = false;
+    bool benchKernels = false;
+};
+
+static uint64_t xorshift(uint64_t &state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+static bool printTrace(const string &path, uint64_t tick) {
+    TraceFile file;
+    if (!file.open(path))
+        return false;
+    LOGINFO("trace ticks : {} - {}", file.getFirstTick(), file.getLastTick());
+    for (uint32_t i = 0; i < file.getSignalCount(); i++)
+        std::cout << file.getSignalName(i) << " = " << file.valueAt(i, tick) << '\n';
+    return true;
+}
+
+static bool buildCircuit(Circuit &circuit, const Options &options) {
+    if (options.perfTest > 0) {
+        std::srand(0);
+        addPerformanceTest(circuit, options.perfTest, vec2(1280, 720));
+        return true;
+    }
+    return loadCircuit(circuit, options.circuitPath);
+}
+
+// Connectors & slots the dead sweep stopped computing, their states are stale.
+struct Swept {
+    std::unordered_set<const Connector *> connectors;
+    std::unordered_map<const Node *, std::vector<bool>> slots; // per instance, per slot
+};
+
+static Swept findSwept(const Netlist &net) {
+    Swept swept;
+    std::vector<bool> pins(net.pinCount, false);
+    for (uint32_t pin: net.sweptPins)
+        pins[pin] = true;
+    for (uint32_t pin = 0; pin < net.pinCount; pin++)
+        if (pins[pin] && net.connectors[pin])
+            swept.connectors.insert(net.connectors[pin]);
+    for (const auto &alias: net.aliases)
+        if (pins[alias.second])
+            swept.connectors.insert(alias.first);
+    for (size_t i = 0; i < net.instances.size(); i++) {
+        std::vector<bool> &slots = swept.slots[net.instances[i]];
+        for (uint32_t k = net.instanceStart[i]; k < net.instanceStart[i + 1]; k++)
+            slots.push_back(pins[net.instancePins[k]]);
+    }
+    return swept;
+}
+
+// Connectors, instance slots & links of `circuit` differing from the same ones in `reference`.
+static long long countMismatches(Circuit &circuit, const Circuit &reference) {
+    const Swept swept = findSwept(circuit.getSimulator().getNetlist());
+    auto differs = [&](const Connector *a, const Connector *b) {
+        return !swept.connectors.count(a) && a->state != b->state;
+    };
+    circuit.sync();
+    const std::vector<Node *> &nodes = circuit.getNodes();
+    const std::vector<Node *> &refNodes = reference.getNodes();
+    long long mismatches = 0;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        for (size_t j = 0; j < nodes[i]->inputs.size(); j++)
+            mismatches += differs(nodes[i]->inputs[j], refNodes[i]->inputs[j]);
+        for (size_t j = 0; j < nodes[i]->outputs.size(); j++)
+            mismatches += differs(nodes[i]->outputs[j], refNodes[i]->outputs[j]);
+        if (nodes[i]->getOp() == NodeOp::COMPOSITE) {
+            const std::vector<bool> &states = static_cast<const CompositeNode *>(nodes[i])->states;
+            const std::vector<bool> &refStates = static_cast<const CompositeNode *>(refNodes[i])->states;
+            auto it = swept.slots.find(nodes[i]);
+            for (size_t j = 0; j < states.size(); j++)
+                mismatches += (it == swept.slots.end() || !it->second[j]) && states[j] != refStates[j];
+        }
+    }
+    for (size_t i = 0; i < circuit.getLinks().size(); i++) {
+        const Link *a = circuit.getLinks()[i];
+        const Link *b = reference.getLinks()[i];
+        mismatches += (!swept.connectors.count(a->output) && a->state != b->state) ||
+                       (!swept.connectors.count(a->input) && a->nextState != b->nextState);
+    }
+    return mismatches;
+}
+
+// Zero delay results must match the unit delay states once the circuit had time to settle. Depth & loops are
+// measured on the reference, NOT pairs & the sweep shrink the settled netlist.
+static bool verifySettle(Circuit &circuit, const Options &options) {
+    Circuit reference;
+    if (!buildCircuit(reference, options))
+        return false;
+    Simulator &unitDelay = reference.getSimulator();
+    SettleEngine settler;
+    settler.build(unitDelay.getNetlist());
+    if (settler.getLoopCount() > 0) {
+        LOGWARN("Settle verification skipped, the circuit has loops : {}", settler.getLoopCount());
+        return true;
+    }
+    for (uint32_t i = 0; i < 2 * settler.getDepth() + 2; i++)
+        unitDelay.tick();
+    reference.sync();
+    long long mismatches = countMismatches(circuit, reference);
+    if (mismatches) {
+        LOGERROR("Settle verification failed, mismatching connectors & links : {}", mismatches);
+        return false;
+    }
+    LOGINFO("Settle verification passed");
+    return true;
+}
+
+// Run the reference update on a second copy for the ticks `circuit` ran and compare every connector & link.
+static bool verify(Circuit &circuit, const Options &options, uint64_t ticks) {
+    if (circuit.getSimulator().getMode() == EngineMode::SETTLE)
+        return verifySettle(circuit, options);
+    Circuit reference;
+    if (!buildCircuit(reference, options))
+        return false;
+    for (uint64_t i = 0; i < ticks; i++) {
+        reference.referenceBeginUpdate();
+        reference.referenceEndUpdate();
+    }
+    long long mismatches = countMismatches(circuit, reference);
+    if (mismatches) {
+        LOGERROR("Verification failed, mismatching connectors & links : {}", mismatches);
+        return false;
+    }
+    LOGINFO("Verification passed");
+    return true;
+}
+
+// Run random input vectors on every lane, then check a few lanes against the scalar simulator.
+template<typename Word>
+static bool runBitsliced(Circuit &circuit, const Options &options) {
+    BitslicedSimulator<Word> simulator(circuit.getSimulator());
+    constexpr int lanes = BitslicedSimulator<Word>::laneCount();
+    uint64_t seed = 0x9E3779B97F4A7C15ull;
+    std::vector<Word> inputs(simulator.getInputCount(), LaneTraits<Word>::fill(false));
+    for (size_t i = 0; i < inputs.size(); i++) {
+        for (int lane = 0; lane < lanes; lane++)
+            LaneTraits<Word>::set(inputs[i], lane, xorshift(seed) & 1);
+        simulator.setInput(i, inputs[i]);
+    }
+    LOGINFO("lanes : {}, circuit inputs : {}", lanes, simulator.getInputCount());
+
+    auto start = std::chrono::steady_clock::now();
+    for (long long i = 0; i < options.ticks; i++)
+        simulator.tick();
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+    LOGINFO("ticks : {}, seconds : {}, vector ticks/s : {}", options.ticks, seconds,
+            seconds > 0 ? (double) options.ticks * lanes / seconds : 0.0);
+
+    if (!options.verify)
+        return true;
+    for (int lane: {0, lanes / 2 + 1, lanes - 1}) {
+        Circuit reference;
+        if (!buildCircuit(reference, options))
+            return false;
+        // The scalar engine, lanes run full ticks
+        Simulator &single = reference.getSimulator();
+        single.setMode(EngineMode::FULL);
+        for (size_t i = 0; i < inputs.size(); i++)
+            single.setPin(single.getNetlist().circuitInputs[i], LaneTraits<Word>::get(inputs[i], lane));
+        for (long long i = 0; i < options.ticks; i++)
+            single.tick();
+        const std::vector<uint8_t> &expected = single.getPins();
+        std::vector<uint8_t> actual;
+        simulator.extractLane(lane, actual);
+        // Scalar pins are padded past the netlist ones
+        if (!std::equal(actual.begin(), actual.end(), expected.begin())) {
+            LOGERROR("Lane verification failed on lane : {}", lane);
+            return false;
+        }
+    }
+    LOGINFO("Lane verification passed");
+    return true;
+}
+
+// Lower to an and-inverter graph, write it & run random input vectors on it, 64 per word. With --verify, a few
+// vectors are checked against the settle engine (loop free circuits only).
+static bool runAig(Circuit &circuit, const Options &options) {
+    const Simulator &simulator = circuit.getSimulator();
+    Aig aig = Aig::fromNetlist(simulator.getNetlist(), simulator.getPins()).cleanup();
+    LOGINFO("netlist gates : {}, links : {}", simulator.getNetlist().gateCount, simulator.getNetlist().getLinkCount());
+    LOGINFO("aig : inputs {}, latches {}, outputs {}, ands {}, bytes {}", aig.getInputCount(), aig.getLatchCount(),
+            aig.getOutputs().size(), aig.getAndCount(), aig.getMemoryUsage());
+    if (!aig.writeAiger(options.aigPath))
+        return false;
+
+    uint64_t seed = 0x9E3779B97F4A7C15ull;
+    std::vector<uint64_t> values(aig.getVariableCount(), 0), inputs(aig.getInputCount());
+    for (uint32_t i = 0; i < aig.getInputCount(); i++)
+        values[1 + i] = inputs[i] = xorshift(seed);
+    for (uint32_t i = 0; i < aig.getLatchCount(); i++)
+        values[1 + aig.getInputCount() + i] = aig.getLatchInit()[i] ? ~0ull : 0;
+    std::vector<uint64_t> next(aig.getLatchCount());
+    auto start = std::chrono::steady_clock::now();
+    for (long long t = 0; t < options.ticks; t++) {
+        aig.simulate(values);
+        for (uint32_t i = 0; i < aig.getLatchCount(); i++)
+            next[i] = Aig::valueOf(values, aig.getLatchNext()[i]);
+        std::copy(next.begin(), next.end(), values.begin() + 1 + aig.getInputCount());
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    LOGINFO("aig ticks : {}, seconds : {}, vector ticks/s : {}", options.ticks, seconds,
+            seconds > 0 ? (double) options.ticks * 64 / seconds : 0.0);
+
+    if (!options.verify)
+        return true;
+    if (aig.getLatchCount() > 0) {
+        LOGWARN("AIG verification skipped, the circuit has loops : {}", aig.getLatchCount());
+        return true;
+    }
+    aig.simulate(values);
+    for (int lane: {0, 33, 63}) {
+        Circuit reference;
+        if (!buildCircuit(reference, options))
+            return false;
+        Simulator &settle = reference.getSimulator();
+        settle.setMode(EngineMode::SETTLE);
+        const Netlist &net = settle.getNetlist();
+        for (uint32_t i = 0; i < aig.getInputCount(); i++)
+            settle.setPin(net.circuitInputs[i], inputs[i] >> lane & 1);
+        settle.tick();
+        for (size_t o = 0; o < aig.getOutputs().size(); o++)
+            if (settle.getPins()[net.circuitOutputs[o]] != (Aig::valueOf(values, aig.getOutputs()[o]) >> lane & 1)) {
+                LOGERROR("AIG verification failed on lane : {}", lane);
+                return false;
+            }
+    }
+    LOGINFO("AIG verification passed");
+    return true;
+}
+
+// Settled outputs of a loop free circuit for one input vector.
+static std::vector<uint8_t> settleOutputs(Circuit &circuit, const std::vector<bool> &inputs) {
+    Simulator &simulator = circuit.getSimulator();
+    simulator.setMode(EngineMode::SETTLE);
+    const Netlist &net = simulator.getNetlist();
+    for (size_t i = 0; i < inputs.size() && i < net.circuitInputs.size(); i++)
+        simulator.setPin(net.circuitInputs[i], inputs[i]);
+    simulator.tick();
+    std::vector<uint8_t> outputs;
+    for (uint32_t pin: net.circuitOutputs)
+        outputs.push_back(simulator.getPins()[pin]);
+    return outputs;
+}
+
+// With --verify, a counterexample must give different settled outputs on both circuits.
+static bool runEquivalence(Circuit &circuit, const Options &options) {
+    Circuit other;
+    if (!loadCircuit(other, options.equivPath))
+        return false;
+    Aig a = Aig::fromCircuit(circuit), b = Aig::fromCircuit(other);
+    LOGINFO("aig ands : {} / {}", a.getAndCount(), b.getAndCount());
+    EquivalenceOptions equivalence;
+    equivalence.threads = (uint32_t) std::max(options.threads, 0);
+    auto start = std::chrono::steady_clock::now();
+    EquivalenceResult result = checkEquivalence(a, b, equivalence);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (result.status == EquivalenceResult::Status::INCOMPATIBLE)
+        return false;
+    LOGINFO("candidates : {}, proved : {}, refuted : {}, SAT calls : {}", result.candidates, result.proved,
+            result.refuted, result.satCalls);
+    switch (result.status) {
+        case EquivalenceResult::Status::EQUIVALENT:
+            LOGINFO("Equivalent, outputs : {}, seconds : {}", a.getOutputs().size(), seconds);
+            return true;
+        case EquivalenceResult::Status::UNDECIDED:
+            LOGWARN("Equivalence undecided, seconds : {}", seconds);
+            return false;
+        default:
+            break;
+    }
+    string inputs;
+    for (bool bit: result.counterexample)
+        inputs += bit ? '1' : '0';
+    LOGWARN("Not equivalent, output {} differs for inputs (node order) : {}", result.output, inputs);
+    if (options.verify) {
+        std::vector<uint8_t> x = settleOutputs(circuit, result.counterexample);
+        std::vector<uint8_t> y = settleOutputs(other, result.counterexample);
+        if (x[result.output] == y[result.output]) {
+            LOGERROR("Counterexample verification failed on output : {}", result.output);
+            return false;
+        }
+        LOGINFO("Counterexample verification passed");
+    }
+    return false;
+}
+
+// With --verify, the first & last rows and a few random ones are checked against the settle engine.
+static bool runTruthTable(Circuit &circuit, const Options &options) {
+    Aig aig = Aig::fromCircuit(circuit);
+    const bool keep = !options.truthTablePath.empty() || options.verify;
+    if (keep && aig.getInputCount() > TRUTH_TABLE_MAX_WRITTEN_INPUTS) {
+        LOGERROR("Too many inputs to keep the truth table, use --truth-hash alone : {}", aig.getInputCount());
+        return false;
+    }
+    TruthTable table;
+    auto start = std::chrono::steady_clock::now();
+    if (!buildTruthTable(aig, table, (uint32_t) std::max(options.threads, 0), keep))
+        return false;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const uint64_t rows = 1ull << table.inputCount;
+    LOGINFO("truth table : inputs {}, outputs {}, ands {}", table.inputCount, table.outputCount, aig.getAndCount());
+    LOGINFO("rows : {}, seconds : {}, rows/s : {}", rows, seconds, seconds > 0 ? (double) rows / seconds : 0.0);
+    LOGINFO("hash : {}", table.getHashText());
+    if (!options.truthTablePath.empty() && !table.write(options.truthTablePath))
+        return false;
+
+    if (!options.verify)
+        return true;
+    uint64_t seed = 0x9E3779B97F4A7C15ull;
+    std::vector<uint64_t> checked = {0, rows - 1};
+    for (int i = 0; i < 16; i++)
+        checked.push_back(xorshift(seed) & (rows - 1));
+    for (uint64_t row: checked) {
+        std::vector<bool> inputs(table.inputCount);
+        for (uint32_t i = 0; i < table.inputCount; i++)
+            inputs[i] = row >> i & 1;
+        std::vector<uint8_t> outputs = settleOutputs(circuit, inputs);
+        for (uint32_t k = 0; k < table.outputCount; k++)
+            if (outputs[k] != table.get(row, k)) {
+                LOGERROR("Truth table verification failed on row : {}", row);
+                return false;
+            }
+    }
+    LOGINFO("Truth table verification passed");
+    return true;
+}
+
+// Same circuit & ticks with each kernel set, results must match the scalar kernels.
+static bool benchKernels(const Options &options) {
+    std::vector<uint8_t> expected;
+    for (const GateKernels *kernels: getSupportedGateKernels()) {
+        Circuit circuit;
+        if (!buildCircuit(circuit, options))
+            return false;
+        Simulator &simulator = circuit.getSimulator();
+        simulator.setKernels(*kernels);
+        auto start = std::chrono::steady_clock::now();
+        for (long long i = 0; i < options.ticks; i++)
+            simulator.tick();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const Netlist &net = simulator.getNetlist();
+        double gates = (double) net.gateCount * options.ticks;
+        double links = (double) net.getLinkCount() * options.ticks;
+        LOGINFO("kernels : {}, gates/s : {}, links/s : {}", kernels->name, gates / seconds, links / seconds);
+
+        std::vector<uint8_t> pins(simulator.getPins().begin(), simulator.getPins().begin() + net.pinCount);
+        if (expected.empty())
+            expected = pins;
+        else if (pins != expected) {
+            LOGERROR("Kernel results differ from scalar : {}", kernels->name);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char const *argv[]) {
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if ((!std::strcmp(arg, "-n") || !std::strcmp(arg, "--ticks")) && hasValue)
+            options.ticks = std::atoll(argv[++i]);
+        else if (!std::strcmp(arg, "--perf-test") && hasValue)
+            options.perfTest = std::atoi(argv[++i]);
+        else if (!std::strcmp(arg, "--save") && hasValue)
+            options.savePath = argv[++i];
+        else if (!std::strcmp(arg, "--engine") && hasValue) {
+            string engine = argv[++i];
+            if (engine == "full")
+                options.engine = EngineMode::FULL;
+            else if (engine == "event")
+                options.engine = EngineMode::EVENT;
+            else if (engine == "settle")
+                options.engine = EngineMode::SETTLE;
+            else {
+                printUsage();
+                return 1;
+            }
+        } else if (!std::strcmp(arg, "--threads") && hasValue)
+            options.threads = std::atoi(argv[++i]);
+        else if (!std::strcmp(arg, "--lookahead") && hasValue)
+            options.lookahead = std::atoi(argv[++i]);
+        else if (!std::strcmp(arg, "--lut-inputs") && hasValue)
+            options.lutInputs = std::atoi(argv[++i]);
+        else if (!std::strcmp(arg, "--lockstep"))
+            options.lockstep = true;
+        else if (!std::strcmp(arg, "--detect-cycles"))
+            options.detectCycles = true;
+        else if (!std::strcmp(arg, "--history") && hasValue)
+            options.historyMB = std::atoi(argv[++i]);
+        else if (!std::strcmp(arg, "--trace") && hasValue)
+            options.tracePath = argv[++i];
+        else if (!std::strcmp(arg, "--break") && hasValue)
+            options.breakpoints.emplace_back(argv[++i]);
+        else if (!std::strcmp(arg, "--trace-at") && hasValue)
+            options.traceAt = std::atoll(argv[++i]);
+        else if (!std::strcmp(arg, "--lanes") && hasValue)
+            options.lanes = std::atoi(argv[++i]);
+        else if (!std::strcmp(arg, "--aig") && hasValue)
+            options.aigPath = argv[++i];
+        else if (!std::strcmp(arg, "--equiv") && hasValue)
+            options.equivPath = argv[++i];
+        else if (!std::strcmp(arg, "--truth-table") && hasValue)
+            options.truthTablePath = argv[++i];
+        else if (!std::strcmp(arg, "--truth-hash"))
+            options.truthHash = true;
+        else if (!std::strcmp(arg, "--bench-kernels"))
+            options.benchKernels = true;
+        else if (!std::strcmp(arg, "--no-optimize"))
+            options.optimize = false;
+        else if (!std::strcmp(arg, "--sweep"))
+            options.sweep = true;
+        else if (!std::strcmp(arg, "--verify"))
+            options.verify = true;
+        else if (!std::strcmp(arg, "-h") || !std::strcmp(arg, "--help")) {
+            printUsage();
+            return 0;
+        } else if (arg[0] != '-' && options.circuitPath.empty())
+            options.circuitPath = arg;
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (options.perfTest <= 0 && options.circuitPath.empty()) {
+        printUsage();
+        return 1;
+    }
+
+    if (options.benchKernels)
+        return benchKernels(options) ? 0 : 1;
+
+    Circuit circuit;
+    if (!buildCircuit(circuit, options))
+        return 1;
+
+    if (!options.savePath.empty() && !saveCircuit(circuit, options.savePath))
+        return 1;
+
+    LOGINFO("nodes : {}, links : {}", circuit.getNodes().size(), circuit.getLinks().size());
+    LOGINFO("kernels : {}", circuit.getSimulator().getKernels().name);
+
+    if (!options.aigPath.empty())
+        return runAig(circuit, options) ? 0 : 1;
+    if (!options.equivPath.empty())
+        return runEquivalence(circuit, options) ? 0 : 1;
+    if (!options.truthTablePath.empty() || options.truthHash)
+        return runTruthTable(circuit, options) ? 0 : 1;
+
+    switch (options.lanes) {
+        case 1:
+            break;
+        case 64:
+            return runBitsliced<uint64_t>(circuit, options) ? 0 : 1;
+        case 256:
+            return runBitsliced<Lanes256>(circuit, options) ? 0 : 1;
+        case 512:
+            return runBitsliced<Lanes512>(circuit, options) ? 0 : 1;
+        default:
+            LOGERROR("Unsupported lane count : {}", options.lanes);
+            return 1;
+    }
+
+    Simulator &simulator = circuit.getSimulator();
+    simulator.setLutInputs((uint32_t) std::max(options.lutInputs, 0));
+    simulator.setMode(options.engine);
+    std::vector<string> breakpoints = circuit.getBreakpoints();
+    breakpoints.insert(breakpoints.end(), options.breakpoints.begin(), options.breakpoints.end());
+    // Without probes in the file, trace & break on every gate output
+    if ((!options.tracePath.empty() || !breakpoints.empty()) && circuit.getProbes().empty())
+        for (Node *node: circuit.getNodes())
+            for (Connector *c: node->outputs)
+                circuit.addProbe(c);
+
+    // Headless, nothing else is shown : NOT pairs (settle only) & the sweep are fine
+    OptimizeOptions optimization;
+    optimization.constants = optimization.merge = optimization.notPairs = options.optimize;
+    optimization.sweep = options.optimize && options.sweep;
+    simulator.setOptimization(optimization);
+    circuit.getSimulator();
+    const OptimizeReport &report = simulator.getOptimizeReport();
+    LOGINFO("optimized : constant gates {}, NOT pairs {}, merged gates {}, dead gates {}, links removed {}",
+            report.constantGates, report.notPairs, report.mergedGates, report.deadGates, report.removedLinks);
+    LOGINFO("simulated gates : {}, links : {}", simulator.getNetlist().gateCount, simulator.getNetlist().getLinkCount());
+
+    simulator.setThreadCount((uint32_t) std::max(options.threads, 0));
+    LOGINFO("threads : {}", simulator.getThreadCount());
+    if (simulator.getThreadCount() > 1)
+        LOGINFO("partitions : {}, cut links : {}", simulator.getNetlist().partitionCount, simulator.getNetlist().cutLinks);
+    simulator.setLookahead((uint32_t) std::max(options.lookahead, 1));
+    simulator.setCycleDetection(options.detectCycles);
+    simulator.setHistoryBudget((size_t) std::max(options.historyMB, 0) << 20);
+    std::vector<string> names;
+    std::vector<const Connector *> probed;
+    for (const Probe &probe: circuit.getProbes()) {
+        names.push_back(probe.name);
+        probed.push_back(probe.connector);
+    }
+    for (const string &expression: breakpoints)
+        if (simulator.addBreakpoint(expression, names, probed) < 0)
+            return 1;
+    std::unique_ptr<TraceWriter> trace;
+    bool binaryTrace = false;
+    if (!options.tracePath.empty()) {
+        const string &path = options.tracePath;
+        binaryTrace = path.size() < 4 || path.compare(path.size() - 4, 4, ".vcd") != 0;
+        if (binaryTrace)
+            trace = std::make_unique<TraceFileWriter>();
+        else
+            trace = std::make_unique<VcdWriter>();
+        if (!trace->open(path, names))
+            return 1;
+        simulator.attachTrace(trace.get(), probed);
+    }
+    double activity = 0;
+    uint64_t firstTick = simulator.getTick();
+    auto start = std::chrono::steady_clock::now();
+    if (options.engine == EngineMode::EVENT || options.lockstep) {
+        for (long long i = 0; i < options.ticks && simulator.getBreakpointHit() < 0; i++) {
+            simulator.tick();
+            activity += simulator.getLastActivity();
+        }
+    } else if (options.ticks > 0) {
+        simulator.runTicks((uint64_t) options.ticks);
+        activity = (double) simulator.getLastActivity() * (double) (simulator.getTick() - firstTick);
+    }
+    auto end = std::chrono::steady_clock::now();
+    uint64_t ticks = simulator.getTick() - firstTick;
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    LOGINFO("ticks : {}, seconds : {}, ticks/s : {}", ticks, seconds,
+            seconds > 0 ? (double) ticks / seconds : 0.0);
+    if (simulator.getBreakpointHit() >= 0)
+        LOGINFO("breakpoint {} hit at tick {}", breakpoints[simulator.getBreakpointHit()], simulator.getTick());
+    if (ticks > 0 && simulator.getNetlist().gateCount > 0)
+        LOGINFO("average gates evaluated per tick : {}", activity / (double) ticks);
+    if (simulator.getThreadCount() > 1 && !options.lockstep && options.engine == EngineMode::FULL)
+        LOGINFO("lookahead : {}, partition stalls : {}", simulator.getLookahead(), simulator.getStallCount());
+    if (options.detectCycles) {
+        const CycleDetector &cycles = simulator.getCycleDetector();
+        if (cycles.isDetected())
+            LOGINFO("period : {} (detected at tick {}), skipped ticks : {}", cycles.getPeriod(),
+                    cycles.getDetectionTick(), simulator.getSkippedTicks());
+        else
+            LOGINFO("no repeating state found, ticks : {}", simulator.getTick());
+    }
+    if (trace) {
+        simulator.detachTrace(trace.get());
+        auto closeStart = std::chrono::steady_clock::now();
+        trace->close();
+        double closeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - closeStart).count();
+        LOGINFO("trace signals : {}, changes : {}, seconds to close : {}", trace->getSignalCount(),
+                trace->getChangeCount(), closeSeconds);
+        if (binaryTrace && options.traceAt >= 0 && !printTrace(options.tracePath, (uint64_t) options.traceAt))
+            return 1;
+    }
+    if (simulator.getHistory().isEnabled()) {
+        const StateHistory &history = simulator.getHistory();
+        LOGINFO("history : ticks {} - {}, bytes : {}", history.getFirstTick(), history.getLastTick(),
+                history.getMemoryUsage());
+    }
+    if (options.engine == EngineMode::SETTLE) {
+        const SettleEngine &settler = simulator.getSettleEngine();
+        LOGINFO("depth : {}, loops : {}, unstable loops : {}", settler.getDepth(), settler.getLoopCount(),
+                settler.getUnstableCount());
+        LOGINFO("lookup tables : {}, gates replaced : {}, table bytes : {}, depth with tables : {}",
+                settler.getLutCount(), settler.getLutGateCount(), settler.getTableBytes(), settler.getLutDepth());
+    }
+
+    if (options.verify && !verify(circuit, options, ticks))
+        return 1;
+    return 0;
+}
@@ -11,5 +11,3 @@ using std::string;
 #elif defined(__linux__)
 #define PLATFORM_LINUX 1
 #endif
-
-#define MULTI_CORES 0
\ No newline at end of file
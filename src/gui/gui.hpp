@@ -4,6 +4,7 @@
 #include "platform/platform.hpp"
 #include "render/backend.hpp"
 #include "render/text.hpp"
+#include "sim/waveform.hpp"
 #include <optional>
 #include <vector>
 #include <algorithm>
@@ -20,6 +21,11 @@ namespace gui {
         vec3 textColor = vec3(1.0f);
         vec3 dropDownHoverColor = vec3(1, 0.5f, 0);
         vec3 dropDownColor = vec3(0.2f);
+        float waveRowHeight = 22;
+        float waveNameWidth = 140;
+        float waveTextSize = 12;
+        vec3 waveColor = vec3(0.2f, 0.9f, 0.3f);
+        vec3 waveToggleColor = vec3(0.1f, 0.45f, 0.15f);
         Font &font;
 
         Theme(Font &font) : font(font) {};
@@ -171,6 +177,55 @@ namespace gui {
             return selected;
         }
 
+        // Probed signals stacked in `area`, `ticksPerPixel` ticks per pixel column up to tick `now` on the right.
+        // Runs of equal columns become one rect : a row never draws more rects than it has columns, whatever the zoom.
+        void waveformPanel(const WaveformRecorder &waves, Rect area, uint64_t now, double ticksPerPixel,
+                           const mat4 &pmat) {
+            drawRect(Rect(area.pos, area.size, theme.backgoundColor));
+            renderRect(pmat);
+
+            std::vector<string> names = waves.getSignalNames();
+            uint32_t columns = (uint32_t) std::max(0.0f, area.size.x - theme.waveNameWidth);
+            double span = ticksPerPixel * columns;
+            uint64_t from = (double) now + 1 > span ? now + 1 - (uint64_t) span : 0;
+            std::vector<WaveState> states;
+            float y = area.pos.y + theme.dropDownMargin;
+            for (uint32_t i = 0; i < names.size() && y + theme.waveRowHeight <= area.pos.y + area.size.y; i++) {
+                theme.font.text(names[i], vec2(area.pos.x + theme.dropDownMargin, y), theme.waveTextSize,
+                                theme.textColor);
+                waves.summarize(i, from, ticksPerPixel, columns, now, states);
+                float x0 = area.pos.x + theme.waveNameWidth;
+                float top = y + 2, bottom = y + theme.waveRowHeight - 4;
+                uint32_t start = 0;
+                for (uint32_t c = 1; c <= columns; c++) {
+                    if (c < columns && states[c] == states[start])
+                        continue;
+                    float x = x0 + (float) start, w = (float) (c - start);
+                    switch (states[start]) {
+                        case WaveState::ZERO:
+                            drawRect(Rect(vec2(x, bottom - 2), vec2(w, 2), theme.waveColor));
+                            break;
+                        case WaveState::ONE:
+                            drawRect(Rect(vec2(x, top), vec2(w, 2), theme.waveColor));
+                            break;
+                        case WaveState::TOGGLING:
+                            drawRect(Rect(vec2(x, top), vec2(w, bottom - top), theme.waveToggleColor));
+                            break;
+                        case WaveState::NONE:
+                            break;
+                    }
+                    // Edge between two constant runs
+                    if (c < columns && states[start] != WaveState::NONE && states[c] != WaveState::NONE &&
+                        states[start] != WaveState::TOGGLING && states[c] != WaveState::TOGGLING)
+                        drawRect(Rect(vec2(x0 + (float) c - 1, top), vec2(2, bottom - top), theme.waveColor));
+                    start = c;
+                }
+                y += theme.waveRowHeight;
+            }
+            renderRect(pmat, 0, 0);
+            theme.font.render(pmat);
+        }
+
     private:
         Theme theme;
         Shader guiRectShader;
@@ -181,6 +236,13 @@ namespace gui {
         }
 
         void renderRect(const mat4 &pmat){
+            renderRect(pmat, theme.cornerRadius, 1.5f);
+        }
+
+        // Square & full size rects with radius & inset 0
+        void renderRect(const mat4 &pmat, float radius, float inset){
+            if (rectDrawCalls.empty())
+                return;
             std::vector<float> verts;
             verts.reserve(rectDrawCalls.size()*7);
             for(auto &r : rectDrawCalls)
@@ -193,7 +255,8 @@ namespace gui {
             vao.addBuffer(vbo, layout);
             guiRectShader.use();
             guiRectShader.setMat4("view", pmat);
-            guiRectShader.setFloat("radius", theme.cornerRadius);
+            guiRectShader.setFloat("radius", radius);
+            guiRectShader.setFloat("inset", inset);
             glDrawArrays(GL_POINTS, 0, rectDrawCalls.size());
 
             rectDrawCalls.clear();
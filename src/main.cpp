@@ -5,6 +5,9 @@
 #include "render/text.hpp"
 #include "node/node_system.hpp"
 #include "node/nodes.hpp"
+#include "sim/equivalence.hpp"
+#include "sim/sim_thread.hpp"
+#include "sim/truth_table.hpp"
 #include "gui/gui.hpp"
 #include <chrono>
 #include <ratio>
@@ -24,6 +27,10 @@ vec2 oldMouse = vec2(0);
 vec2 mouse = vec2(0);
 bool viewPanning = false;
 
+// Editor commands running on the simulation thread hold its ticks back, these keep them to a few seconds
+constexpr uint32_t GUI_TRUTH_TABLE_MAX_INPUTS = 20;    // 1M rows written
+constexpr uint64_t GUI_EQUIVALENCE_CONFLICTS = 100000; // per output pair
+
 mat4 getViewMatrix() {
     mat4 view = scale(identity<4>(), vec3(zoom, zoom, 1));
     vec3 viewTranslate = vec3((1 - zoom) / 2.0f, (1 - zoom) / 2.0f, 0) + vec3(viewOffset, 0);
@@ -68,13 +75,9 @@ int main(int argc, char const *argv[]) {
 
     NodeManager NodeManager;
 
-    unsigned int tickPerSec = 1;
-    auto simStartTime = std::chrono::steady_clock::now();
-    auto tickTime = 1000000000ns / tickPerSec;
-    bool beginUpdateDone = false;
+    double tickPerSec = 1;
     bool boxSelection = false;
     vec2 boxSelectionStart = vec2(0);
-    bool unlimitedTickTime = false;
     int fps = 60;
 
     vec2 orpos = vec2((float) platform.getWidth() / 2.0f, (float) platform.getHeight() / 2.0f);
@@ -91,6 +94,17 @@ int main(int argc, char const *argv[]) {
     NodeManager.addNode(or1);
     NodeManager.addNode(not3);
 
+    // Simulation
+    SimulationThread simulation;
+    simulation.setTickRate(tickPerSec);
+    simulation.setTickMode(TickMode::FIXED);
+    simulation.setCycleDetection(true);
+    // Stepping back needs every tick recorded, which costs the lookahead engine its batches : only "Advance 1M
+    // ticks" still runs them, forgetting the history before
+    simulation.setHistoryBudget((size_t) 256 << 20);
+    // Circuit the edits are checked against, see "Check against reference"
+    std::optional<Aig> equivalenceReference;
+
     // GUI
     gui::GUIManager guiManager;
     
@@ -101,10 +115,13 @@ int main(int argc, char const *argv[]) {
     // 3 -> File menu
     // 4 -> Edit menu
     // 5 -> Help menu
+    // 6 -> Simulation menu
     int contextMenu = -1;
     vec2 contextMenuPos;
     std::optional<Node *> grabNode = {};
     std::optional<Connector *> startConnector = {};
+    bool showWaveforms = false;
+    double waveTicksPerPixel = 1;
 
     while (platform.processEvents()) {
 
@@ -122,6 +139,14 @@ int main(int argc, char const *argv[]) {
             viewOffset = viewOffset + mouse - oldMouse;
         }
         int delta = platform.getMouseWheel();
+        // Waveform panel along the bottom, above the status line
+        float wavePanelHeight = std::min(200.0f, (float) height / 3);
+        gui::Rect wavePanel(vec2(0, (float) height - 24 - wavePanelHeight), vec2((float) width, wavePanelHeight));
+        if (delta != 0 && showWaveforms && gui::Rect::pointInRect(wavePanel, mouse)) {
+            waveTicksPerPixel *= std::pow(0.8, delta);
+            waveTicksPerPixel = std::clamp(waveTicksPerPixel, 1.0 / 16, 1e12);
+            delta = 0;
+        }
         // update zoom
         if (delta != 0) {
             vec2 tempMouse = (getInvViewMatrix() * vec4(mouse, 0, 1)).xy;
@@ -250,8 +275,20 @@ int main(int argc, char const *argv[]) {
         }
 
         // ---- simulation ----
-
-
+        // send edits, then show the latest state of the current netlist
+        if (!NodeManager.isCompiled())
+            simulation.load(NodeManager.getSimulator(), NodeManager.takeStateEdits());
+        simulation.updateSnapshot();
+        const SimulationSnapshot &snapshot = simulation.getSnapshot();
+        if (snapshot.version == simulation.getVersion()) {
+            NodeManager.getSimulator().writePins(snapshot.pins);
+            float t = 1;
+            if (snapshot.midTick && snapshot.tickPeriod.count() > 0) {
+                auto elapsed = std::chrono::steady_clock::now() - snapshot.tickStart;
+                t = std::min(1.0f, (float) ((double) elapsed.count() / (double) snapshot.tickPeriod.count()));
+            }
+            NodeManager.setProgress(t);
+        }
 
         NodeManager.render(pmat, view, (invView * vec4(0, 0, 0, 1)).xy,
                            (invView * vec4((float) width, (float) height, 0, 1)).xy);
@@ -260,10 +297,15 @@ int main(int argc, char const *argv[]) {
             NodeManager.drawBoxSelection(boxSelectionStart, worldMouse, pmat, view);
         }
 
+        // Follows the latest tick
+        if (showWaveforms)
+            guiManager.waveformPanel(simulation.getWaveforms(), wavePanel, snapshot.tick, waveTicksPerPixel, pmat);
+
         switch (contextMenu) {
             case 0:
             {
-                static std::vector<string> list = {"Remove", "Replace"};
+                static std::vector<string> list = {"Remove", "Replace", "Toggle input", "Toggle probes",
+                                                   "Break on change", "Group"};
                 int index = guiManager.dropDownMenu(list, contextMenuPos, pmat, {"Action menu"});
                 if (platform.isMousePressed(MouseButton::LEFT)) {
                     contextMenu = -1;
@@ -275,12 +317,27 @@ int main(int argc, char const *argv[]) {
                         case 1:
                             contextMenu = 1;
                             break;
+                        case 2:
+                            NodeManager.toggleSelectedInputs();
+                            break;
+                        case 3:
+                            NodeManager.toggleSelectedProbes();
+                            break;
+                        case 4:
+                            if (NodeManager.breakOnSelectedProbes())
+                                simulation.addBreakpoint(NodeManager.getBreakpoints().back(), NodeManager.getProbes());
+                            else
+                                LOGWARN("No probed output selected");
+                            break;
+                        case 5:
+                            NodeManager.groupSelected();
+                            break;
                     }
                 }
             }
                 break;
             case 1:{
-                static std::vector<string> list = {"TRUE", "NOT", "OR", "AND", "XOR"};
+                static std::vector<string> list = {"TRUE", "NOT", "OR", "AND", "XOR", "IN", "OUT"};
                 int index = guiManager.dropDownMenu(list, contextMenuPos, pmat, {"Replace nodes menu"});
                 if (platform.isMousePressed(MouseButton::LEFT)) {
                     contextMenu = -1;
@@ -300,12 +357,18 @@ int main(int argc, char const *argv[]) {
                         case 4:
                             NodeManager.replaceSelected([](vec2 pos){return new XorNode(pos);});
                             break;
+                        case 5:
+                            NodeManager.replaceSelected([](vec2 pos){return new InputNode(pos);});
+                            break;
+                        case 6:
+                            NodeManager.replaceSelected([](vec2 pos){return new OutputNode(pos);});
+                            break;
                     }
                 }
             }
                 break;
             case 2 : {
-                static std::vector<string> list = {"TRUE", "NOT", "OR", "AND", "XOR", "PERFORMANCE TEST (40k)"};
+                static std::vector<string> list = {"TRUE", "NOT", "OR", "AND", "XOR", "IN", "OUT", "PERFORMANCE TEST (40k)"};
                 int index = guiManager.dropDownMenu(list, contextMenuPos, pmat, {"Add node menu"});
                 if (platform.isMousePressed(MouseButton::LEFT)) {
                     contextMenu = -1;
@@ -327,25 +390,13 @@ int main(int argc, char const *argv[]) {
                             NodeManager.addNode(new XorNode(pos));
                             break;
                         case 5:
-                            for (int i = 0; i < 10000; i++)
-                            {
-
-                                Node *n1 = new TrueNode(25.0f * vec2(std::rand() % platform.getWidth(), std::rand() % platform.getHeight()));
-                                Node *n2 = new NotNode(25.0f * vec2(std::rand() % platform.getWidth(), std::rand() % platform.getHeight()));
-                                Link *n1n2 = new Link(n1->getOutput("out"), n2->getInput("in"));
-                                NodeManager.addLink(n1n2);
-                                NodeManager.addNode(n1);
-                                NodeManager.addNode(n2);
-
-                                Node *n3 = new NotNode(25.0f * vec2(std::rand() % platform.getWidth(), std::rand() % platform.getHeight()));
-                                Node *n4 = new NotNode(25.0f * vec2(std::rand() % platform.getWidth(), std::rand() % platform.getHeight()));
-                                Link *n3n4 = new Link(n3->getOutput("out"), n4->getInput("in"));
-                                Link *n1n3 = new Link(n1->getOutput("out"), n3->getInput("in"));
-                                NodeManager.addLink(n3n4);
-                                NodeManager.addLink(n1n3);
-                                NodeManager.addNode(n3);
-                                NodeManager.addNode(n4);
-                            }
+                            NodeManager.addNode(new InputNode(pos));
+                            break;
+                        case 6:
+                            NodeManager.addNode(new OutputNode(pos));
+                            break;
+                        case 7:
+                            addPerformanceTest(NodeManager, 10000, vec2((float) platform.getWidth(), (float) platform.getHeight()));
                             break;
                     }
                 }
@@ -374,9 +425,176 @@ int main(int argc, char const *argv[]) {
                     contextMenu = -1;
                 }
             } break;
+            // Simulation menu
+            case 6 : {
+                static std::vector<string> list = {"Full engine", "Event driven engine", "Settle engine (zero delay)",
+                                                          "Single thread", "Every core",
+                                                          "Fixed tick rate", "Catch up when late", "Turbo",
+                                                          "Tick rate x10", "Tick rate /10", "Advance 1M ticks",
+                                                          "Skip 1000 periods", "Pause", "Resume", "Step back",
+                                                          "Step forward", "Back 100 ticks", "Forward 100 ticks",
+                                                          "Start VCD trace", "Start binary trace", "Stop trace",
+                                                          "Show waveforms", "Hide waveforms", "Arm breakpoints",
+                                                          "Clear breakpoints", "Optimize netlist", "Simulate as drawn",
+                                                          "Truth table", "Set equivalence reference",
+                                                          "Check against reference"};
+                int index = guiManager.dropDownMenu(list, contextMenuPos, pmat, {"Simulation menu"});
+                if (platform.isMousePressed(MouseButton::LEFT)) {
+                    contextMenu = -1;
+                    switch (index) {
+                        case 0:
+                            simulation.setMode(EngineMode::FULL);
+                            break;
+                        case 1:
+                            simulation.setMode(EngineMode::EVENT);
+                            break;
+                        case 2:
+                            simulation.setMode(EngineMode::SETTLE);
+                            break;
+                        case 3:
+                            simulation.setThreadCount(1);
+                            break;
+                        case 4:
+                            simulation.setThreadCount(0);
+                            break;
+                        case 5:
+                            simulation.setTickMode(TickMode::FIXED);
+                            break;
+                        case 6:
+                            simulation.setTickMode(TickMode::CATCH_UP);
+                            break;
+                        case 7:
+                            simulation.setTickMode(TickMode::TURBO);
+                            break;
+                        case 8:
+                            tickPerSec = std::min(tickPerSec * 10, 1e9);
+                            simulation.setTickRate(tickPerSec);
+                            break;
+                        case 9:
+                            tickPerSec = std::max(tickPerSec / 10, 0.01);
+                            simulation.setTickRate(tickPerSec);
+                            break;
+                        case 10:
+                            simulation.advance(1000000);
+                            break;
+                        case 11:
+                            // Computes nothing once the period is known, only the tick counter moves
+                            if (snapshot.period)
+                                simulation.advance(snapshot.period * 1000);
+                            break;
+                        case 12:
+                            simulation.setPaused(true);
+                            break;
+                        case 13:
+                            simulation.setPaused(false);
+                            break;
+                        case 14:
+                            simulation.rewind(1);
+                            break;
+                        case 15:
+                            simulation.advance(1);
+                            break;
+                        case 16:
+                            simulation.rewind(100);
+                            break;
+                        case 17:
+                            // Replays the recorded ticks, stops at the last one
+                            simulation.seek(snapshot.tick + 100);
+                            break;
+                        case 18:
+                        case 19:
+                            if (NodeManager.getProbes().empty())
+                                LOGWARN("Nothing to trace, probe some nodes first");
+                            else
+                                simulation.startTrace(index == 18 ? "trace.vcd" : "trace.bbt", NodeManager.getProbes());
+                            break;
+                        case 20:
+                            simulation.stopTrace();
+                            break;
+                        case 21:
+                            if (NodeManager.getProbes().empty())
+                                LOGWARN("No waveform to show, probe some nodes first");
+                            else {
+                                simulation.showWaveforms(NodeManager.getProbes());
+                                showWaveforms = true;
+                            }
+                            break;
+                        case 22:
+                            simulation.hideWaveforms();
+                            showWaveforms = false;
+                            break;
+                        case 23:
+                            // The ones saved with the circuit
+                            simulation.clearBreakpoints();
+                            for (const string &expression: NodeManager.getBreakpoints())
+                                simulation.addBreakpoint(expression, NodeManager.getProbes());
+                            break;
+                        case 24:
+                            simulation.clearBreakpoints();
+                            NodeManager.clearBreakpoints();
+                            break;
+                        case 25:
+                        case 26: {
+                            // Recompiles with or without the passes, the states carry over
+                            OptimizeOptions optimization;
+                            optimization.constants = optimization.merge = index == 25;
+                            NodeManager.getSimulator().setOptimization(optimization);
+                            simulation.load(NodeManager.getSimulator(), NodeManager.takeStateEdits());
+                            const OptimizeReport &report = NodeManager.getSimulator().getOptimizeReport();
+                            LOGINFO("optimized : constant gates {}, merged gates {}, links removed {}",
+                                    report.constantGates, report.mergedGates, report.removedLinks);
+                        } break;
+                        case 27: {
+                            // Enumerated on the simulation thread, larger ones are for basicbool-sim --truth-hash
+                            Aig aig = Aig::fromCircuit(NodeManager);
+                            if (aig.getInputCount() > GUI_TRUTH_TABLE_MAX_INPUTS) {
+                                LOGWARN("Too many inputs for a truth table from the editor : {}", aig.getInputCount());
+                                break;
+                            }
+                            simulation.runJob([aig]() {
+                                TruthTable table;
+                                if (!buildTruthTable(aig, table) || !table.write("truth_table.txt"))
+                                    return;
+                                LOGINFO("truth_table.txt written, inputs {}, outputs {}, hash {}", table.inputCount,
+                                        table.outputCount, table.getHashText());
+                            });
+                        } break;
+                        case 28:
+                            equivalenceReference = Aig::fromCircuit(NodeManager);
+                            LOGINFO("Equivalence reference set, inputs {}, outputs {}",
+                                    equivalenceReference->getInputCount(), equivalenceReference->getOutputs().size());
+                            break;
+                        case 29: {
+                            if (!equivalenceReference) {
+                                LOGWARN("Set an equivalence reference first");
+                                break;
+                            }
+                            // On the simulation thread with a bounded search, so a hard output ends up undecided
+                            Aig reference = *equivalenceReference, current = Aig::fromCircuit(NodeManager);
+                            simulation.runJob([reference, current]() {
+                                EquivalenceOptions options;
+                                options.outputConflicts = GUI_EQUIVALENCE_CONFLICTS;
+                                EquivalenceResult result = checkEquivalence(reference, current, options);
+                                if (result.status == EquivalenceResult::Status::EQUIVALENT)
+                                    LOGINFO("Equivalent to the reference, outputs : {}", current.getOutputs().size());
+                                else if (result.status == EquivalenceResult::Status::UNDECIDED)
+                                    LOGWARN("Equivalence undecided within the conflict budget : {}",
+                                            GUI_EQUIVALENCE_CONFLICTS);
+                                else if (result.status == EquivalenceResult::Status::DIFFERENT) {
+                                    string inputs;
+                                    for (bool bit: result.counterexample)
+                                        inputs += bit ? '1' : '0';
+                                    LOGWARN("Differs from the reference on output {} for inputs : {}", result.output,
+                                            inputs);
+                                }
+                            });
+                        } break;
+                    }
+                }
+            } break;
         }
 
-        static std::vector<string> fileMenu = {"File", "Edit", "Help"};
+        static std::vector<string> fileMenu = {"File", "Edit", "Simulation", "Help"};
         auto info = guiManager.fileMenu(fileMenu, pmat);
         switch (info.first) {
             case 0:
@@ -388,51 +606,43 @@ int main(int argc, char const *argv[]) {
                 contextMenuPos = info.second;
                 break;
             case 2:
+                contextMenu = 6;
+                contextMenuPos = info.second;
+                break;
+            case 3:
                 contextMenu = 5;
                 contextMenuPos = info.second;
                 break;
         }
 
 
-        auto endTime = std::chrono::steady_clock::now();
-        auto workTime = endTime-startTime;
-        static auto targetTime = std::chrono::duration<long long , std::ratio<1, 60>>{1}; // 60 Hz
-
-        // TODO : improve this busy update loop
-        while (std::chrono::steady_clock::now()-startTime < targetTime){
-            // start cycle
-            if (!unlimitedTickTime) {
-                if (!beginUpdateDone) {
-                    NodeManager.beginUpdate();
-                    beginUpdateDone = true;
-                    simStartTime = std::chrono::steady_clock::now();
-                }
-                auto time = std::chrono::steady_clock::now();
-                auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(time - simStartTime);
-                auto t = (float) ((double) duration.count() / (double) tickTime.count());
-                if (t > 1)
-                    t = 1;
-                // update animation
-                NodeManager.setProgress(t);
-                // end cycle
-                if (duration >= tickTime) {
-                    NodeManager.endUpdate();
-                    beginUpdateDone = false;
-                }
-            } else {
-                NodeManager.beginUpdate();
-                NodeManager.setProgress(1);
-                NodeManager.endUpdate();
-            }
-        }
-
-        string text = std::to_string(fps);
-        font.text("fps : " + text, vec2(0, height-font.getHeight("fps : " + text, 20)), 20, vec3(1));
+        string text = "fps : " + std::to_string(fps) + "   ticks/s : " + std::to_string((long long) snapshot.ticksPerSecond);
+        if (snapshot.advancedTicks)
+            text += "   advanced " + std::to_string(snapshot.advancedTicks) + " ticks in " +
+                    std::to_string(snapshot.advanceSeconds) + " s";
+        if (snapshot.cycleStatus == CycleStatus::SETTLED)
+            text += "   settled";
+        else if (snapshot.cycleStatus == CycleStatus::PERIODIC)
+            text += "   periodic(" + std::to_string(snapshot.period) + ")";
+        if (simulation.isTracing())
+            text += "   tracing : " + std::to_string(snapshot.tracedChanges) + " changes";
+        if (!snapshot.breakpoint.empty())
+            text += "   break : " + snapshot.breakpoint;
+        else if (simulation.getBreakpointCount())
+            text += "   breakpoints : " + std::to_string(simulation.getBreakpointCount());
+        if (snapshot.paused)
+            text += "   paused at tick " + std::to_string(snapshot.tick) + ", history " +
+                    std::to_string(snapshot.historyFirst) + " - " + std::to_string(snapshot.historyLast);
+        font.text(text, vec2(0, height-font.getHeight(text, 20)), 20, vec3(1));
         font.render(pmat);
 
         // End drawing
         platform.swapBuffers();
 
+        // Ticks run on the simulation thread, sleep until the next frame
+        static auto targetTime = std::chrono::duration<long long, std::ratio<1, 60>>{1}; // 60 Hz
+        std::this_thread::sleep_until(startTime + targetTime);
+
         // FPS info
         auto afterSleep = std::chrono::steady_clock::now();
         long long finalElapsedTime = std::chrono::duration_cast<std::chrono::microseconds>(afterSleep-startTime).count();
@@ -0,0 +1,313 @@
+#include "circuit.hpp"
+#include "composite.hpp"
+#include "sim/simulator.hpp"
+#include <algorithm>
+#include <unordered_set>
+
+// Names
+const string &internName(const string &name) {
+    static std::unordered_set<string> names;
+    return *names.insert(name).first;
+}
+
+// Connector
+static uint64_t nextConnectorId = 0;
+
+uint64_t reserveConnectorIds(uint64_t count) {
+    uint64_t first = nextConnectorId;
+    nextConnectorId += count;
+    return first;
+}
+
+Connector::Connector(string name, Node *parent, bool isInput)
+        : id(nextConnectorId++), parent(parent), name(internName(name)), isInput(isInput) {}
+
+// Links
+Link::Link(Connector *in, Connector *out) : input(in), output(out) {
+    in->links.push_back(this);
+    out->links.push_back(this);
+    fetchNextState();
+}
+
+Link::~Link() {
+    input->links.erase(std::remove(input->links.begin(), input->links.end(), this), input->links.end());
+    output->links.erase(std::remove(output->links.begin(), output->links.end(), this), output->links.end());
+    output->state = false;
+}
+
+void Link::fetchNextState() {
+    nextState = input->state;
+}
+
+void Link::propagate() {
+    output->state = nextState;
+    state = nextState; // current state
+}
+
+void Link::reset() {
+    state = false;
+    fetchNextState();
+}
+
+// Node
+Node::Node(string name, vec2 pos) : name(internName(name)), pos(pos) {}
+
+Node::~Node() {
+    for (Connector *c: inputs)
+        delete c;
+    for (Connector *c: outputs)
+        delete c;
+}
+
+bool Node::addOutput(string name) {
+    auto i = std::find_if(outputs.begin(), outputs.end(), [&name](Connector *c) { return c->name == name; });
+    if (i == outputs.end()) {
+        outputs.push_back(new Connector(name, this, false));
+        return true;
+    }
+    return false;
+}
+
+bool Node::addInput(string name) {
+    auto i = std::find_if(inputs.begin(), inputs.end(), [&name](Connector *c) { return c->name == name; });
+    if (i == inputs.end()) {
+        inputs.push_back(new Connector(name, this, true));
+        return true;
+    }
+    return false;
+}
+
+Connector *Node::getInput(string name) {
+    auto i = std::find_if(inputs.begin(), inputs.end(), [&name](Connector *c) { return c->name == name; });
+    if (i != inputs.end())
+        return inputs[std::distance(inputs.begin(), i)];
+    return nullptr;
+}
+
+Connector *Node::getOutput(string name) {
+    auto i = std::find_if(outputs.begin(), outputs.end(), [&name](Connector *c) { return c->name == name; });
+    if (i != outputs.end())
+        return outputs[std::distance(outputs.begin(), i)];
+    return nullptr;
+}
+
+// Circuit
+
+Circuit::Circuit() : simulator(std::make_unique<Simulator>()) {}
+
+Circuit::~Circuit() {
+    clear();
+}
+
+Simulator &Circuit::getSimulator() {
+    if (compiled && simulator->needsReload())
+        invalidate();
+    if (!compiled) {
+        simulator->load(*this);
+        compiled = true;
+    }
+    return *simulator;
+}
+
+void Circuit::sync() {
+    if (!compiled)
+        return;
+    simulator->store();
+}
+
+void Circuit::invalidate() {
+    sync();
+    compiled = false;
+}
+
+void Circuit::clear() {
+    invalidate();
+    expansion.reset();
+    // LINKS FIRST
+    for (Link *link: links)
+        delete link;
+    for (Node *node: nodes)
+        delete node;
+    links.clear();
+    nodes.clear();
+    probes.clear();
+    breakpoints.clear();
+    definitions.clear();
+}
+
+void Circuit::setInput(Node *node, bool value) {
+    invalidate();
+    for (Connector *c: node->outputs) {
+        c->state = value;
+        stateEdits.connectors.push_back(c);
+    }
+}
+
+void Circuit::reset() {
+    invalidate();
+    stateEdits.all = true;
+    for (Node *node: nodes)
+        node->reset();
+    for (Link *link: links)
+        link->reset();
+}
+
+StateEdits Circuit::takeStateEdits() {
+    StateEdits edits = std::move(stateEdits);
+    stateEdits = StateEdits();
+    return edits;
+}
+
+void Circuit::addNode(Node *node) {
+    invalidate();
+    nodes.push_back(node);
+}
+
+void Circuit::addLink(Link *link) {
+    invalidate();
+    links.push_back(link);
+}
+
+void Circuit::beginUpdate() {
+    getSimulator().beginUpdate();
+}
+
+void Circuit::endUpdate() {
+    getSimulator().endUpdate();
+}
+
+// A single value for every link, only the renderer reads it.
+void Circuit::setProgress(float t) {
+    progress = t;
+}
+
+// Instance bodies run as real nodes & links, links reading a port read what drives it
+void Circuit::referenceBeginUpdate() {
+    invalidate();
+    expansion = std::make_unique<Expansion>(*this);
+    expansion->load();
+    const FlatCircuit &flat = expansion->flat;
+    for (Node *node: flat.nodes)
+        node->update();
+    for (size_t i = 0; i < flat.links.size(); i++)
+        flat.links[i]->nextState = flat.sources[i]->state;
+}
+
+void Circuit::referenceEndUpdate() {
+    invalidate();
+    if (!expansion)
+        return;
+    const FlatCircuit &flat = expansion->flat;
+    for (Link *li: flat.links)
+        li->propagate();
+    for (const auto &alias: flat.aliases)
+        alias.first->state = alias.second->state;
+    expansion->store();
+    expansion.reset();
+}
+
+void Circuit::replaceNode(Node *node, std::function<Node *(vec2)> build) {
+    invalidate();
+    Node *rnode = build(node->pos);
+    // ---- Inputs ----
+    for (int i = 0; i < node->inputs.size() && i < rnode->inputs.size(); i++) {
+        Connector *c = node->inputs[i];
+        // copy links
+        for (Link *l: c->links) {
+            Link *nl = new Link(l->input, rnode->inputs[i]);
+            addLink(nl);
+            nl->nextState = l->nextState;
+        }
+    }
+    // ---- Outputs ----
+    for (int i = 0; i < node->outputs.size() && i < rnode->outputs.size(); i++) {
+        Connector *c = node->outputs[i];
+        // copy links
+        for (Link *l: c->links) {
+            Link *nl = new Link(rnode->outputs[i], l->output);
+            addLink(nl);
+        }
+    }
+    removeNode(node);
+    addNode(rnode);
+}
+
+void Circuit::addProbe(Connector *c, string name) {
+    if (isProbed(c))
+        return;
+    if (name.empty()) {
+        const std::vector<Connector *> &list = c->isInput ? c->parent->inputs : c->parent->outputs;
+        size_t index = std::find(list.begin(), list.end(), c) - list.begin();
+        size_t node = std::find(nodes.begin(), nodes.end(), c->parent) - nodes.begin();
+        name = c->parent->name + std::to_string(node) + "_" + (c->isInput ? "in" : "out") + std::to_string(index);
+    }
+    probes.push_back(Probe{c, name});
+}
+
+void Circuit::removeProbe(const Connector *c) {
+    probes.erase(std::remove_if(probes.begin(), probes.end(), [c](const Probe &p) { return p.connector == c; }),
+                 probes.end());
+}
+
+bool Circuit::isProbed(const Connector *c) const {
+    return std::any_of(probes.begin(), probes.end(), [c](const Probe &p) { return p.connector == c; });
+}
+
+void Circuit::addDefinition(std::shared_ptr<CircuitDefinition> definition) {
+    definition->finish();
+    definitions.push_back(std::move(definition));
+}
+
+std::shared_ptr<CircuitDefinition> Circuit::findDefinition(const string &name) const {
+    for (const auto &definition: definitions)
+        if (definition->name == name)
+            return definition;
+    return nullptr;
+}
+
+bool Circuit::connect(Connector *c1, Connector *c2) {
+    invalidate();
+    if (!c1->isInput && c2->isInput) {
+        if (!(c2->links.empty())) {
+            Link *li = c2->links[0];
+            links.erase(std::remove(links.begin(), links.end(), li), links.end());
+            delete li;
+        }
+        links.push_back(new Link(c1, c2));
+        return true;
+    } else if (c1->isInput && !c2->isInput) {
+
+        if (!(c1->links.empty())) {
+            Link *li = c1->links[0];
+            links.erase(std::remove(links.begin(), links.end(), li), links.end());
+            delete li;
+        }
+        links.push_back(new Link(c2, c1));
+        return true;
+    }
+    return false;
+}
+
+void Circuit::disconnectAll(Connector *c) {
+    invalidate();
+    std::vector<Link *> temp = c->links;
+    for (Link *li: temp) {
+        links.erase(std::remove(links.begin(), links.end(), li), links.end());
+        delete li;
+    }
+}
+
+void Circuit::removeNode(Node *node) {
+    invalidate();
+    // remove & delete links
+    for (Connector *c: node->inputs)
+        disconnectAll(c);
+    for (Connector *c: node->outputs)
+        disconnectAll(c);
+    probes.erase(std::remove_if(probes.begin(), probes.end(), [node](const Probe &p) {
+        return p.connector->parent == node;
+    }), probes.end());
+    // remove & delete node
+    nodes.erase(std::remove(nodes.begin(), nodes.end(), node), nodes.end());
+    delete node;
+}
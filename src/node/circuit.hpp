@@ -0,0 +1,220 @@
+// Editable circuit graph and its reference simulation.
+// Nothing in here depends on OpenGL so it can be used without a window.
+
+#pragma once
+
+#include "core/defines.hpp"
+#include "core/math.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class Node;
+
+struct Link;
+
+class Simulator;
+
+struct CircuitDefinition;
+
+struct Expansion;
+
+// What a node computes. The simulator compiles nodes by operation instead of calling update().
+enum class NodeOp : uint8_t {
+    NONE,   // outputs are never written (sources)
+    INPUT,  // circuit input, a source set from outside
+    OUTPUT, // circuit output, a sink
+    COMPOSITE, // subcircuit, flattened into its primitives when compiling (see node/composite.hpp)
+    NOT,
+    AND,
+    OR,
+    XOR,
+    COUNT
+};
+
+// Gates compute their single output from their inputs, everything else only holds values.
+inline bool isGateOp(NodeOp op) {
+    return op >= NodeOp::NOT && op < NodeOp::COUNT;
+}
+
+// Shared copy of a connector or node name, names repeat across thousands of nodes.
+const string &internName(const string &name);
+
+// `count` consecutive connector ids, for states that have no Connector (see node/composite.hpp).
+uint64_t reserveConnectorIds(uint64_t count);
+
+struct Connector {
+    uint64_t id; // unique for the whole run, unlike addresses that get reused
+    Node *parent;
+    std::vector<Link *> links;
+    bool state = false;
+    const string &name; // interned
+    vec2 pos;     // relative to parent node
+    vec2 textPos; // relative to parent node
+    bool isInput = false;
+
+    Connector(string name, Node *parent, bool isInput);
+};
+
+// in -> out
+struct Link {
+    Connector *input;
+    Connector *output;
+    bool state = false;
+    bool nextState = false;
+
+    Link(Connector *in, Connector *out);
+
+    ~Link();
+
+    void fetchNextState();
+
+    void propagate();
+
+    void reset();
+};
+
+// Connectors whose state was written by setInput() or reset(), their previous simulated state must be dropped.
+struct StateEdits {
+    std::vector<const Connector *> connectors;
+    bool all = false;
+};
+
+// A connector whose value changes are traced (see sim/vcd_writer.hpp).
+struct Probe {
+    Connector *connector;
+    string name;
+};
+
+class Node {
+public:
+    std::vector<Connector *> inputs;
+    std::vector<Connector *> outputs;
+    bool selected = false;
+    const string &name; // interned
+    vec2 pos;
+    vec2 textPos; // relative to it's pos
+    vec2 headerSize;
+    vec2 size;
+
+    Node(string name, vec2 pos);
+
+    virtual ~Node();
+
+    bool addOutput(string name);
+
+    bool addInput(string name);
+
+    Connector *getInput(string name);
+
+    Connector *getOutput(string name);
+
+    virtual NodeOp getOp() const = 0;
+
+    virtual void update() = 0;
+
+    virtual void reset() = 0;
+};
+
+// Owns nodes & links and steps them one tick at a time.
+// Nodes & links are only the authoring model : ticks run on a compiled netlist (see sim/simulator.hpp)
+// which is rebuilt after each edit and written back to the connectors by sync().
+class Circuit {
+public:
+    Circuit();
+
+    Circuit(const Circuit &) = delete;
+
+    Circuit &operator=(const Circuit &) = delete;
+
+    virtual ~Circuit();
+
+    virtual void addNode(Node *node);
+
+    void addLink(Link *link);
+
+    bool connect(Connector *c1, Connector *c2);
+
+    void disconnectAll(Connector *c);
+
+    void removeNode(Node *node);
+
+    void replaceNode(Node *node, std::function<Node *(vec2)> build);
+
+    void clear();
+
+    // Set the value an IN node drives.
+    void setInput(Node *node, bool value);
+
+    void reset();
+
+    void beginUpdate();
+
+    void endUpdate();
+
+    // Position of the displayed tick in [0, 1], links are drawn moving from state to nextState.
+    void setProgress(float t);
+
+    float getProgress() const { return progress; }
+
+    // Write the simulation state back to connectors & links.
+    void sync();
+
+    // Sync and drop the compiled netlist, call it before editing nodes or links directly.
+    void invalidate();
+
+    // Step the nodes & links objects directly, slow but it is the reference behavior.
+    void referenceBeginUpdate();
+
+    void referenceEndUpdate();
+
+    const std::vector<Node *> &getNodes() const { return nodes; }
+
+    const std::vector<Link *> &getLinks() const { return links; }
+
+    // Probes don't change the netlist, an empty name picks one from the node & connector names.
+    void addProbe(Connector *c, string name = "");
+
+    void removeProbe(const Connector *c);
+
+    bool isProbed(const Connector *c) const;
+
+    const std::vector<Probe> &getProbes() const { return probes; }
+
+    // Breakpoint expressions over the probe names, see sim/breakpoint.hpp. Kept with the circuit, not checked here.
+    void addBreakpoint(const string &expression) { breakpoints.push_back(expression); }
+
+    void clearBreakpoints() { breakpoints.clear(); }
+
+    const std::vector<string> &getBreakpoints() const { return breakpoints; }
+
+    // Subcircuit types composite nodes are built from, by name. Adding a definition finishes it.
+    void addDefinition(std::shared_ptr<CircuitDefinition> definition);
+
+    std::shared_ptr<CircuitDefinition> findDefinition(const string &name) const;
+
+    const std::vector<std::shared_ptr<CircuitDefinition>> &getDefinitions() const { return definitions; }
+
+    Simulator &getSimulator();
+
+    // False after an edit, until getSimulator() compiles the circuit again.
+    bool isCompiled() const { return compiled; }
+
+    // State edits since the last call.
+    StateEdits takeStateEdits();
+
+protected:
+    std::vector<Node *> nodes;
+    std::vector<Link *> links;
+    std::vector<Probe> probes;
+    std::vector<string> breakpoints;
+    std::vector<std::shared_ptr<CircuitDefinition>> definitions;
+
+private:
+    std::unique_ptr<Simulator> simulator;
+    std::unique_ptr<Expansion> expansion; // instance bodies, between referenceBeginUpdate() & referenceEndUpdate()
+    bool compiled = false;
+    float progress = 0.5f;
+    StateEdits stateEdits;
+};
@@ -0,0 +1,171 @@
+#include "circuit_io.hpp"
+#include "composite.hpp"
+#include "nodes.hpp"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+// Lines up to the end of the file, or up to "end" inside a def. Types are looked up in `root` definitions.
+static bool loadLines(std::istream &file, Circuit &circuit, Circuit &root, CircuitDefinition *definition,
+                      const string &path, int &lineNumber) {
+    std::vector<Node *> nodes;
+    string line;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        std::istringstream ss(line);
+        string keyword;
+        if (!(ss >> keyword) || keyword[0] == '#')
+            continue;
+        if (keyword == "node") {
+            string type;
+            vec2 pos;
+            if (!(ss >> type >> pos.x >> pos.y)) {
+                LOGERROR("Malformed node at {}:{}", path, lineNumber);
+                return false;
+            }
+            Node *node = createNode(type, pos);
+            if (!node) {
+                std::shared_ptr<CircuitDefinition> composite = root.findDefinition(type);
+                if (composite)
+                    node = new CompositeNode(pos, composite);
+            }
+            if (!node) {
+                LOGERROR("Unknown node type at {}:{} : {}", path, lineNumber, type);
+                return false;
+            }
+            circuit.addNode(node);
+            nodes.push_back(node);
+        } else if (keyword == "link") {
+            int src, srcPin, dst, dstPin;
+            if (!(ss >> src >> srcPin >> dst >> dstPin) ||
+                src < 0 || (size_t) src >= nodes.size() || dst < 0 || (size_t) dst >= nodes.size() ||
+                srcPin < 0 || (size_t) srcPin >= nodes[src]->outputs.size() ||
+                dstPin < 0 || (size_t) dstPin >= nodes[dst]->inputs.size()) {
+                LOGERROR("Malformed link at {}:{}", path, lineNumber);
+                return false;
+            }
+            circuit.connect(nodes[src]->outputs[srcPin], nodes[dst]->inputs[dstPin]);
+        } else if (keyword == "probe" && !definition) {
+            int node, index;
+            string side, name;
+            if (!(ss >> node >> side >> index) || node < 0 || (size_t) node >= nodes.size() || (side != "in" && side != "out")) {
+                LOGERROR("Malformed probe at {}:{}", path, lineNumber);
+                return false;
+            }
+            const std::vector<Connector *> &list = side == "in" ? nodes[node]->inputs : nodes[node]->outputs;
+            if (index < 0 || (size_t) index >= list.size()) {
+                LOGERROR("Malformed probe at {}:{}", path, lineNumber);
+                return false;
+            }
+            ss >> name;
+            circuit.addProbe(list[index], name);
+        } else if (keyword == "break" && !definition) {
+            string expression;
+            std::getline(ss >> std::ws, expression);
+            if (expression.empty()) {
+                LOGERROR("Malformed breakpoint at {}:{}", path, lineNumber);
+                return false;
+            }
+            circuit.addBreakpoint(expression);
+        } else if (keyword == "def" && !definition) {
+            auto def = std::make_shared<CircuitDefinition>();
+            Node *primitive = nullptr;
+            if (!(ss >> def->name) || (primitive = createNode(def->name, vec2(0))) || root.findDefinition(def->name)) {
+                delete primitive;
+                LOGERROR("Malformed or duplicate def at {}:{}", path, lineNumber);
+                return false;
+            }
+            if (!loadLines(file, def->body, root, def.get(), path, lineNumber))
+                return false;
+            root.addDefinition(def);
+        } else if (keyword == "ports" && definition) {
+            string side, name;
+            if (!(ss >> side) || (side != "in" && side != "out")) {
+                LOGERROR("Malformed ports at {}:{}", path, lineNumber);
+                return false;
+            }
+            std::vector<string> &names = side == "in" ? definition->inputNames : definition->outputNames;
+            while (ss >> name)
+                names.push_back(name);
+        } else if (keyword == "end" && definition) {
+            return true;
+        } else {
+            LOGERROR("Unknown keyword at {}:{} : {}", path, lineNumber, keyword);
+            return false;
+        }
+    }
+    if (definition) {
+        LOGERROR("Missing end of def : {}", definition->name);
+        return false;
+    }
+    return true;
+}
+
+bool loadCircuit(Circuit &circuit, const string &path) {
+    std::ifstream file(path);
+    if (!file) {
+        LOGERROR("Can't open circuit file : {}", path);
+        return false;
+    }
+    int lineNumber = 0;
+    return loadLines(file, circuit, circuit, nullptr, path, lineNumber);
+}
+
+static size_t indexOf(const std::vector<Connector *> &list, const Connector *c) {
+    return std::distance(list.begin(), std::find(list.begin(), list.end(), c));
+}
+
+// Node & link lines, nodeIndex gets the file index of every node
+static void saveBody(std::ostream &file, const Circuit &circuit, std::unordered_map<const Node *, size_t> &nodeIndex) {
+    const std::vector<Node *> &nodes = circuit.getNodes();
+    for (size_t i = 0; i < nodes.size(); i++) {
+        file << "node " << nodes[i]->name << ' ' << nodes[i]->pos.x << ' ' << nodes[i]->pos.y << '\n';
+        nodeIndex[nodes[i]] = i;
+    }
+    for (const Link *link: circuit.getLinks()) {
+        const Node *src = link->input->parent;
+        const Node *dst = link->output->parent;
+        file << "link " << nodeIndex[src] << ' ' << indexOf(src->outputs, link->input) << ' '
+             << nodeIndex[dst] << ' ' << indexOf(dst->inputs, link->output) << '\n';
+    }
+}
+
+bool saveCircuit(const Circuit &circuit, const string &path) {
+    std::ofstream file(path);
+    if (!file) {
+        LOGERROR("Can't write circuit file : {}", path);
+        return false;
+    }
+    file << "# BasicBool circuit\n";
+    // A definition only uses the ones before it
+    for (const auto &definition: circuit.getDefinitions()) {
+        std::unordered_map<const Node *, size_t> bodyIndex;
+        file << "def " << definition->name << '\n';
+        saveBody(file, definition->body, bodyIndex);
+        if (!definition->inputNames.empty()) {
+            file << "ports in";
+            for (const string &name: definition->inputNames)
+                file << ' ' << name;
+            file << '\n';
+        }
+        if (!definition->outputNames.empty()) {
+            file << "ports out";
+            for (const string &name: definition->outputNames)
+                file << ' ' << name;
+            file << '\n';
+        }
+        file << "end\n";
+    }
+
+    std::unordered_map<const Node *, size_t> nodeIndex;
+    saveBody(file, circuit, nodeIndex);
+    for (const Probe &probe: circuit.getProbes()) {
+        const Connector *c = probe.connector;
+        file << "probe " << nodeIndex[c->parent] << ' ' << (c->isInput ? "in " : "out ")
+             << indexOf(c->isInput ? c->parent->inputs : c->parent->outputs, c) << ' ' << probe.name << '\n';
+    }
+    for (const string &expression: circuit.getBreakpoints())
+        file << "break " << expression << '\n';
+    return true;
+}
@@ -0,0 +1,19 @@
+// Plain text circuit files.
+//
+//   # comment
+//   node <TYPE> <x> <y>                          nodes are numbered in file order
+//   link <srcNode> <srcOutput> <dstNode> <dstInput>
+//   probe <node> <in|out> <index> [name]         traced connector, see Circuit::addProbe
+//   break <expression>                           breakpoint over probe names, see sim/breakpoint.hpp
+//   def <NAME>                                   subcircuit type, usable as a node type after it (see node/composite.hpp)
+//     node / link lines                          its body, IN & OUT nodes are the ports
+//     ports <in|out> <name>...                   port names, in IN / OUT node order
+//   end
+
+#pragma once
+
+#include "circuit.hpp"
+
+bool loadCircuit(Circuit &circuit, const string &path);
+
+bool saveCircuit(const Circuit &circuit, const string &path);
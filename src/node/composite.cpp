@@ -0,0 +1,165 @@
+#include "composite.hpp"
+#include "nodes.hpp"
+
+void CircuitDefinition::finish() {
+    inputPorts.clear();
+    outputPorts.clear();
+    states.clear();
+    for (Node *node: body.getNodes()) {
+        switch (node->getOp()) {
+            case NodeOp::INPUT:
+                inputPorts.push_back(node);
+                break;
+            case NodeOp::OUTPUT:
+                outputPorts.push_back(node);
+                states.push_back(node->inputs[0]->state);
+                break;
+            case NodeOp::COMPOSITE:
+                for (Connector *c: node->inputs)
+                    states.push_back(c->state);
+                for (bool state: static_cast<CompositeNode *>(node)->states)
+                    states.push_back(state);
+                break;
+            default:
+                for (Connector *c: node->inputs)
+                    states.push_back(c->state);
+                for (Connector *c: node->outputs)
+                    states.push_back(c->state);
+        }
+    }
+}
+
+CompositeNode::CompositeNode(vec2 pos, std::shared_ptr<const CircuitDefinition> def)
+        : Node(def->name, pos), states(def->states), definition(std::move(def)),
+          stateId(reserveConnectorIds(states.size())) {
+    for (size_t i = 0; i < definition->inputPorts.size(); i++)
+        addInput(i < definition->inputNames.size() ? definition->inputNames[i] : "in" + std::to_string(i));
+    for (size_t i = 0; i < definition->outputPorts.size(); i++)
+        addOutput(i < definition->outputNames.size() ? definition->outputNames[i] : "out" + std::to_string(i));
+}
+
+void CompositeNode::reset() {
+    for (Connector *c: inputs)
+        c->state = false;
+    for (Connector *c: outputs)
+        c->state = false;
+    states.assign(states.size(), false);
+}
+
+Node *cloneNode(const Node *node) {
+    Node *copy;
+    if (node->getOp() == NodeOp::COMPOSITE) {
+        auto composite = static_cast<const CompositeNode *>(node);
+        auto instance = new CompositeNode(node->pos, composite->getDefinition());
+        instance->states = composite->states;
+        copy = instance;
+    } else
+        copy = createNode(node->name, node->pos);
+    for (size_t k = 0; k < node->inputs.size(); k++)
+        copy->inputs[k]->state = node->inputs[k]->state;
+    for (size_t k = 0; k < node->outputs.size(); k++)
+        copy->outputs[k]->state = node->outputs[k]->state;
+    return copy;
+}
+
+std::unordered_map<const Connector *, Connector *> copyNodes(const std::vector<Node *> &nodes,
+                                                             const std::vector<Link *> &links, Circuit &to) {
+    std::unordered_map<const Connector *, Connector *> copyOf;
+    for (const Node *node: nodes) {
+        Node *copy = cloneNode(node);
+        for (size_t k = 0; k < node->inputs.size(); k++)
+            copyOf[node->inputs[k]] = copy->inputs[k];
+        for (size_t k = 0; k < node->outputs.size(); k++)
+            copyOf[node->outputs[k]] = copy->outputs[k];
+        to.addNode(copy);
+    }
+    for (const Link *link: links) {
+        auto in = copyOf.find(link->input), out = copyOf.find(link->output);
+        if (in == copyOf.end() || out == copyOf.end())
+            continue;
+        Link *copy = new Link(in->second, out->second);
+        copy->state = link->state;
+        copy->nextState = link->nextState;
+        to.addLink(copy);
+    }
+    return copyOf;
+}
+
+// Clone the body behind `instance`, its slots in slot order
+static void expand(const Node *instance, const CircuitDefinition &definition, std::vector<Connector *> &slots,
+                   Circuit &bodies, FlatCircuit &flat) {
+    const std::vector<Node *> &nodes = definition.body.getNodes();
+    size_t first = bodies.getNodes().size();
+    copyNodes(nodes, definition.body.getLinks(), bodies);
+    std::vector<Node *> copies(bodies.getNodes().begin() + first, bodies.getNodes().begin() + first + nodes.size());
+    size_t in = 0, out = 0;
+    for (Node *copy: copies) {
+        switch (copy->getOp()) {
+            case NodeOp::INPUT:
+                flat.aliases.emplace_back(copy->outputs[0], instance->inputs[in++]);
+                break;
+            case NodeOp::OUTPUT:
+                slots.push_back(copy->inputs[0]);
+                flat.aliases.emplace_back(instance->outputs[out++], copy->inputs[0]);
+                break;
+            case NodeOp::COMPOSITE:
+                slots.insert(slots.end(), copy->inputs.begin(), copy->inputs.end());
+                expand(copy, *static_cast<CompositeNode *>(copy)->getDefinition(), slots, bodies, flat);
+                break;
+            default:
+                flat.nodes.push_back(copy);
+                slots.insert(slots.end(), copy->inputs.begin(), copy->inputs.end());
+                slots.insert(slots.end(), copy->outputs.begin(), copy->outputs.end());
+        }
+    }
+}
+
+Expansion::Expansion(const Circuit &circuit) {
+    for (Node *node: circuit.getNodes()) {
+        if (node->getOp() == NodeOp::COMPOSITE) {
+            auto composite = static_cast<CompositeNode *>(node);
+            slots.emplace_back(composite, std::vector<Connector *>());
+            expand(composite, *composite->getDefinition(), slots.back().second, bodies, flat);
+        } else
+            flat.nodes.push_back(node);
+    }
+    flat.links = circuit.getLinks();
+    flat.links.insert(flat.links.end(), bodies.getLinks().begin(), bodies.getLinks().end());
+    std::unordered_map<const Connector *, Connector *> ports(flat.aliases.begin(), flat.aliases.end());
+
+    // The last link reaching an input drives it
+    std::unordered_map<const Connector *, const Link *> driver;
+    driver.reserve(flat.links.size());
+    for (const Link *link: flat.links)
+        driver[link->output] = link;
+
+    flat.sources.reserve(flat.links.size());
+    for (const Link *link: flat.links) {
+        Connector *c = link->input;
+        // Follow wires through ports, a loop made of wires only stops on a port input
+        for (size_t hops = 0;; hops++) {
+            auto port = ports.find(c);
+            if (port == ports.end())
+                break;
+            auto d = driver.find(port->second);
+            if (d == driver.end() || hops > ports.size()) {
+                c = port->second;
+                break;
+            }
+            c = d->second->input;
+        }
+        flat.sources.push_back(c);
+    }
+}
+
+void Expansion::load() const {
+    for (const auto &instance: slots)
+        for (size_t i = 0; i < instance.second.size(); i++)
+            instance.second[i]->state = instance.first->states[i];
+}
+
+void Expansion::store() const {
+    for (const auto &instance: slots)
+        for (size_t i = 0; i < instance.second.size(); i++)
+            instance.first->states[i] = instance.second[i]->state;
+}
@@ -0,0 +1,89 @@
+// Subcircuits : a node whose body is another circuit.
+//
+// A definition is a template circuit whose IN & OUT nodes are the ports, in node order. It is stored once : an
+// instance only holds its position, its port connectors and one state bit per "slot" of the body. Slots follow the
+// body node order :
+//
+//   IN node          none, it is a wire to the instance input
+//   OUT node         its input
+//   composite node   its inputs, then the slots of its own definition
+//   any other node   its inputs, then its outputs
+//
+// Ports are plain wires : compiling stamps the definition into the netlist for every instance (see sim/netlist.hpp)
+// and a link reading a port reads whatever drives it, so wrapping gates into a composite adds no delay.
+
+#pragma once
+
+#include "circuit.hpp"
+#include <memory>
+#include <unordered_map>
+
+struct CircuitDefinition {
+    string name;
+    Circuit body;
+    std::vector<string> inputNames;  // per IN node of body
+    std::vector<string> outputNames; // per OUT node of body
+
+    // Set by finish()
+    std::vector<Node *> inputPorts;
+    std::vector<Node *> outputPorts;
+    std::vector<bool> states; // per slot, what new instances start from : the states of the body
+
+    // Find the ports & slots once the body is complete, Circuit::addDefinition() calls it.
+    void finish();
+};
+
+class CompositeNode : public Node {
+public:
+    // `definition` must be finished.
+    CompositeNode(vec2 pos, std::shared_ptr<const CircuitDefinition> definition);
+
+    NodeOp getOp() const override {
+        return NodeOp::COMPOSITE;
+    }
+
+    // Never called, instances are flattened.
+    void update() override {
+    }
+
+    void reset() override;
+
+    const std::shared_ptr<const CircuitDefinition> &getDefinition() const { return definition; }
+
+    // Connector ids of the slots, from getStateId() to getStateId() + states.size().
+    uint64_t getStateId() const { return stateId; }
+
+    std::vector<bool> states; // per slot
+
+private:
+    std::shared_ptr<const CircuitDefinition> definition;
+    uint64_t stateId;
+};
+
+// Copy of `node` with the same states.
+Node *cloneNode(const Node *node);
+
+// Copy `nodes` and the links between them into `to`, states included. Returns the copy of every connector.
+std::unordered_map<const Connector *, Connector *> copyNodes(const std::vector<Node *> &nodes,
+                                                             const std::vector<Link *> &links, Circuit &to);
+
+// Primitive view of a circuit for the reference update : instance bodies are cloned into real nodes & links.
+struct FlatCircuit {
+    std::vector<Node *> nodes;       // primitive nodes, the IN & OUT nodes of bodies are ports and left out
+    std::vector<Link *> links;       // every link, bodies included
+    std::vector<Connector *> sources; // per link, the connector it reads once ports are resolved
+    std::vector<std::pair<Connector *, Connector *>> aliases; // port output, input holding its value
+};
+
+struct Expansion {
+    Circuit bodies; // owns the clones
+    FlatCircuit flat;
+    std::vector<std::pair<CompositeNode *, std::vector<Connector *>>> slots; // per instance, the clone of every slot
+
+    explicit Expansion(const Circuit &circuit);
+
+    // Instance states to the clones, and back
+    void load() const;
+
+    void store() const;
+};
@@ -1,81 +1,11 @@
 #include "node_system.hpp"
+#include "composite.hpp"
+#include "nodes.hpp"
 #include "render/backend.hpp"
 #include <cmath>
 #include <optional>
 
 
-// Connector
-Connector::Connector(string name, Node *parent, bool isInput) : name(name), parent(parent), isInput(isInput) {}
-
-// Links
-Link::Link(Connector *in, Connector *out) : input(in), output(out) {
-    in->links.push_back(this);
-    out->links.push_back(this);
-    fetchNextState();
-}
-
-Link::~Link() {
-    input->links.erase(std::remove(input->links.begin(), input->links.end(), this), input->links.end());
-    output->links.erase(std::remove(output->links.begin(), output->links.end(), this), output->links.end());
-    output->state = false;
-}
-
-void Link::fetchNextState() {
-    nextState = input->state;
-}
-
-void Link::propagate() {
-    output->state = nextState;
-    state = nextState; // current state
-}
-
-void Link::reset() {
-    state = false;
-    fetchNextState();
-}
-
-// Node
-Node::Node(string name, vec2 pos) : name(name), pos(pos) {}
-
-Node::~Node() {
-    for (Connector *c: inputs)
-        delete c;
-    for (Connector *c: outputs)
-        delete c;
-}
-
-bool Node::addOutput(string name) {
-    auto i = std::find_if(outputs.begin(), outputs.end(), [&name](Connector *c) { return c->name == name; });
-    if (i == outputs.end()) {
-        outputs.push_back(new Connector(name, this, false));
-        return true;
-    }
-    return false;
-}
-
-bool Node::addInput(string name) {
-    auto i = std::find_if(inputs.begin(), inputs.end(), [&name](Connector *c) { return c->name == name; });
-    if (i == inputs.end()) {
-        inputs.push_back(new Connector(name, this, true));
-        return true;
-    }
-    return false;
-}
-
-Connector *Node::getInput(string name) {
-    auto i = std::find_if(inputs.begin(), inputs.end(), [&name](Connector *c) { return c->name == name; });
-    if (i != inputs.end())
-        return inputs[std::distance(inputs.begin(), i)];
-    return nullptr;
-}
-
-Connector *Node::getOutput(string name) {
-    auto i = std::find_if(outputs.begin(), outputs.end(), [&name](Connector *c) { return c->name == name; });
-    if (i != outputs.end())
-        return outputs[std::distance(outputs.begin(), i)];
-    return nullptr;
-}
-
 // Node manager
 
 NodeManager::NodeManager() : nodeShader("node"),
@@ -87,31 +17,13 @@ NodeManager::NodeManager() : nodeShader("node"),
     setLookAndFeel(std::make_shared<NodeStyle>());
 }
 
-NodeManager::~NodeManager() {
-    // LINKS FIRST
-    for (Link *link: links)
-        delete link;
-    for (Node *node: nodes)
-        delete node;
-}
-
-void NodeManager::reset() {
-    for (Node *node: nodes)
-        node->reset();
-    for (Link *link: links)
-        link->reset();
-}
-
 void NodeManager::addNode(Node *node) {
-    nodes.push_back(node);
+    Circuit::addNode(node);
     doNodeLayout(node);
 }
 
-void NodeManager::addLink(Link *link) {
-    links.push_back(link);
-}
-
 void NodeManager::render(const mat4 &pmat, const mat4 &view, const vec2 &camstart, const vec2 &camend) {
+    sync();
     cullNodes(camstart, camend);
     cullLinks(camstart, camend);
     renderLinks(pmat, view);
@@ -135,52 +47,6 @@ void NodeManager::render(const mat4 &pmat, const mat4 &view, const vec2 &camstar
     visibleLinks.clear();
 }
 
-void NodeManager::beginUpdate() {
-#if MULTI_CORES
-#pragma omp parallel for
-    for (int i = 0; i < nodes.size(); i++)
-    {
-        nodes[i]->update();
-    }
-#pragma omp parallel for
-    for (int i = 0; i < links.size(); i++)
-    {
-        links[i]->fetchNextState();
-    }
-#else
-    for (Node *node: nodes)
-        node->update();
-    for (Link *li: links)
-        li->fetchNextState();
-#endif
-}
-
-void NodeManager::endUpdate() {
-#if MULTI_CORES
-#pragma omp parallel for
-    for (int i = 0; i < links.size(); i++)
-    {
-        links[i]->propagate();
-    }
-#else
-    for (Link *li: links)
-        li->propagate();
-#endif
-}
-
-void NodeManager::setProgress(float t) {
-#if MULTI_CORES
-#pragma omp parallel for
-    for (int i = 0; i < links.size(); i++)
-    {
-        links[i]->t = t;
-    }
-#else
-    for (Link *li: links)
-        li->t = t;
-#endif
-}
-
 void NodeManager::removeSelected() {
     for (Node *node: selectedNodes) {
         removeNode(node);
@@ -230,31 +96,100 @@ void NodeManager::replaceSelected(std::function<Node*(vec2)> build){
         replaceNode(node, build);
 }
 
-void NodeManager::replaceNode(Node* node, std::function<Node*(vec2)> build){
-    Node* rnode = build(node->pos);
-    // ---- Inputs ----
-    for(int i=0; i < node->inputs.size() && i < rnode->inputs.size(); i++){
-        Connector* c = node->inputs[i];
-        // copy links
-        for(Link* l : c->links){
-            Link* nl = new Link(l->input, rnode->inputs[i]);
-            addLink(nl);
-            nl->nextState = l->nextState;
+void NodeManager::toggleSelectedInputs() {
+    for (Node *node: selectedNodes)
+        if (node->getOp() == NodeOp::INPUT)
+            setInput(node, !node->outputs[0]->state);
+}
+
+void NodeManager::toggleSelectedProbes() {
+    for (Node *node: selectedNodes)
+        for (Connector *c: node->outputs) {
+            if (isProbed(c))
+                removeProbe(c);
+            else
+                addProbe(c);
         }
+}
+
+bool NodeManager::breakOnSelectedProbes() {
+    string expression;
+    for (const Probe &probe: probes)
+        if (!probe.connector->isInput && nodeIsSelected(probe.connector->parent))
+            expression += (expression.empty() ? "change(" : " || change(") + probe.name + ")";
+    if (expression.empty())
+        return false;
+    addBreakpoint(expression);
+    return true;
+}
+
+bool NodeManager::groupSelected() {
+    if (selectedNodes.empty())
+        return false;
+    invalidate();
+    auto definition = std::make_shared<CircuitDefinition>();
+    for (size_t i = definitions.size();; i++) {
+        definition->name = "GROUP" + std::to_string(i);
+        if (!findDefinition(definition->name))
+            break;
+    }
+    vec2 origin = selectedNodes[0]->pos, end = origin;
+    for (const Node *node: selectedNodes) {
+        origin = vec2(std::min(origin.x, node->pos.x), std::min(origin.y, node->pos.y));
+        end = vec2(std::max(end.x, node->pos.x + node->size.x), std::max(end.y, node->pos.y + node->size.y));
     }
-    // ---- Outputs ----
-    for(int i=0; i < node->outputs.size() && i <  rnode->outputs.size(); i++){
-        Connector* c = node->outputs[i];
-        // copy links
-        for(Link* l : c->links){
-            Link* nl = new Link(rnode->outputs[i], l->output);
-            addLink(nl);
+    Circuit &body = definition->body;
+    std::unordered_map<const Connector *, Connector *> copyOf = copyNodes(selectedNodes, links, body);
+    for (Node *node: body.getNodes())
+        node->pos = node->pos - origin;
+
+    // One port per outside source read inside, one per inside output read outside
+    std::vector<Link *> crossIn, crossOut;
+    std::unordered_map<const Connector *, Node *> portOf;
+    for (Link *link: links) {
+        bool from = link->input->parent->selected, to = link->output->parent->selected;
+        if (from == to)
+            continue;
+        Node *&port = portOf[link->input];
+        if (!port) {
+            vec2 pos = from ? vec2(end.x - origin.x + 50.0f, 50.0f * (float) crossOut.size())
+                            : vec2(-100.0f, 50.0f * (float) crossIn.size());
+            port = from ? (Node *) new OutputNode(pos) : (Node *) new InputNode(pos);
+            body.addNode(port);
+            if (from)
+                body.connect(copyOf.at(link->input), port->inputs[0]);
         }
+        if (!from)
+            body.connect(port->outputs[0], copyOf.at(link->output));
+        (from ? crossOut : crossIn).push_back(link);
     }
-    removeNode(node);
-    addNode(rnode);
-}
 
+    // Port indices follow the node order of the body
+    std::unordered_map<const Node *, size_t> portIndex;
+    size_t inputCount = 0, outputCount = 0;
+    for (const Node *node: body.getNodes()) {
+        if (node->getOp() == NodeOp::INPUT)
+            portIndex[node] = inputCount++;
+        else if (node->getOp() == NodeOp::OUTPUT)
+            portIndex[node] = outputCount++;
+    }
+    addDefinition(definition);
+    auto instance = new CompositeNode(origin, definition);
+    for (Link *link: crossIn) {
+        Link *outer = new Link(link->input, instance->inputs[portIndex[portOf[link->input]]]);
+        outer->nextState = link->nextState;
+        addLink(outer);
+    }
+    for (Link *link: crossOut) {
+        Link *outer = new Link(instance->outputs[portIndex[portOf[link->input]]], link->output);
+        outer->nextState = link->nextState;
+        addLink(outer);
+    }
+    removeSelected();
+    addNode(instance);
+    selectNode(instance);
+    return true;
+}
 
 void NodeManager::moveSelectedNodes(vec2 offset) {
     for (Node *node: selectedNodes) {
@@ -343,47 +278,6 @@ void NodeManager::drawBoxSelection(vec2 start, vec2 end, const mat4 &pmat, const
     glDrawArrays(GL_POINTS, 0, 1);
 }
 
-bool NodeManager::connect(Connector *c1, Connector *c2) {
-    if (!c1->isInput && c2->isInput) {
-        if (!(c2->links.empty())) {
-            Link *li = c2->links[0];
-            links.erase(std::remove(links.begin(), links.end(), li), links.end());
-            delete li;
-        }
-        links.push_back(new Link(c1, c2));
-        return true;
-    } else if (c1->isInput && !c2->isInput) {
-
-        if (!(c1->links.empty())) {
-            Link *li = c1->links[0];
-            links.erase(std::remove(links.begin(), links.end(), li), links.end());
-            delete li;
-        }
-        links.push_back(new Link(c2, c1));
-        return true;
-    }
-    return false;
-}
-
-void NodeManager::disconnectAll(Connector *c) {
-    std::vector<Link *> temp = c->links;
-    for (Link *li: temp) {
-        links.erase(std::remove(links.begin(), links.end(), li), links.end());
-        delete li;
-    }
-}
-
-void NodeManager::removeNode(Node *node) {
-    // remove & delete links
-    for (Connector *c: node->inputs)
-        disconnectAll(c);
-    for (Connector *c: node->outputs)
-        disconnectAll(c);
-    // remove & delete node
-    nodes.erase(std::remove(nodes.begin(), nodes.end(), node), nodes.end());
-    delete node;
-}
-
 void NodeManager::cullNodes(const vec2 &camstart, const vec2 &camend) {
     for (Node *node: nodes) {
         vec2 pos = node->pos - vec2(nodeStyle->shadowSize);
@@ -527,14 +421,15 @@ void NodeManager::renderLinks(const mat4 &pmat, const mat4 &view) {
         return;
     std::vector<float> vertices;
     vertices.reserve(visibleLinks.size() * 8);
+    const float progress = getProgress();
 
     for (const Link *li: visibleLinks) {
         vec2 inPos = li->input->parent->pos + li->input->pos;
         vec2 outPos = li->output->parent->pos + li->output->pos;
 
         float startTrue = li->state == false && li->nextState == true || li->state == true && li->nextState == true;
-        float t = li->state == false && li->nextState == true || li->state == true && li->nextState == false ? li->t
-                                                                                                             : 1.0;
+        float t = li->state == false && li->nextState == true || li->state == true && li->nextState == false ? progress
+                                                                                                             : 1.0f;
 
         vertices.insert(vertices.end(), {inPos.x, inPos.y, t, startTrue,
                                          outPos.x, outPos.y, t, startTrue});
@@ -1,6 +1,7 @@
 #pragma once
 
-#include "node_system.hpp"
+#include "circuit.hpp"
+#include <cstdlib>
 
 class TrueNode : public Node {
 public:
@@ -9,6 +10,10 @@ public:
         outputs[0]->state = true;
     }
 
+    NodeOp getOp() const override {
+        return NodeOp::NONE;
+    }
+
     void update() override {
     }
 
@@ -24,6 +29,10 @@ public:
         outputs[0]->state = true;
     }
 
+    NodeOp getOp() const override {
+        return NodeOp::NOT;
+    }
+
     void update() override {
         outputs[0]->state = !(inputs[0]->state);
     }
@@ -42,6 +51,10 @@ public:
         addOutput("out");
     }
 
+    NodeOp getOp() const override {
+        return NodeOp::AND;
+    }
+
     void update() override {
         outputs[0]->state = inputs[0]->state && inputs[1]->state;
     }
@@ -61,6 +74,10 @@ public:
         addOutput("out");
     }
 
+    NodeOp getOp() const override {
+        return NodeOp::OR;
+    }
+
     void update() override {
         outputs[0]->state = inputs[0]->state || inputs[1]->state;
     }
@@ -80,6 +97,10 @@ public:
         addOutput("out");
     }
 
+    NodeOp getOp() const override {
+        return NodeOp::XOR;
+    }
+
     void update() override {
         outputs[0]->state = (inputs[0]->state && !inputs[1]->state) || (!inputs[0]->state && inputs[1]->state);
     }
@@ -89,4 +110,84 @@ public:
         inputs[0]->state = false;
         inputs[1]->state = false;
     }
-};
\ No newline at end of file
+};
+
+// Circuit input, a switch driven by the user or by test vectors.
+class InputNode : public Node {
+public:
+    InputNode(vec2 pos) : Node("IN", pos) {
+        addOutput("out");
+    }
+
+    NodeOp getOp() const override {
+        return NodeOp::INPUT;
+    }
+
+    void update() override {
+    }
+
+    void reset() override {
+    }
+};
+
+// Circuit output, only displays the value it receives.
+class OutputNode : public Node {
+public:
+    OutputNode(vec2 pos) : Node("OUT", pos) {
+        addInput("in");
+    }
+
+    NodeOp getOp() const override {
+        return NodeOp::OUTPUT;
+    }
+
+    void update() override {
+    }
+
+    void reset() override {
+        inputs[0]->state = false;
+    }
+};
+
+// Build a node from its type name (as written in circuit files), nullptr if unknown.
+inline Node *createNode(const string &type, vec2 pos) {
+    if (type == "TRUE")
+        return new TrueNode(pos);
+    if (type == "NOT")
+        return new NotNode(pos);
+    if (type == "AND")
+        return new AndNode(pos);
+    if (type == "OR")
+        return new OrNode(pos);
+    if (type == "XOR")
+        return new XorNode(pos);
+    if (type == "IN")
+        return new InputNode(pos);
+    if (type == "OUT")
+        return new OutputNode(pos);
+    return nullptr;
+}
+
+// Scatter `count` groups over `area`, each a TRUE fanning out to a NOT and to a NOT -> NOT chain (4 nodes, 3 links).
+inline void addPerformanceTest(Circuit &circuit, int count, vec2 area) {
+    auto randomPos = [&area]() {
+        return 25.0f * vec2(std::rand() % (int) area.x, std::rand() % (int) area.y);
+    };
+    for (int i = 0; i < count; i++) {
+        Node *n1 = new TrueNode(randomPos());
+        Node *n2 = new NotNode(randomPos());
+        Link *n1n2 = new Link(n1->getOutput("out"), n2->getInput("in"));
+        circuit.addLink(n1n2);
+        circuit.addNode(n1);
+        circuit.addNode(n2);
+
+        Node *n3 = new NotNode(randomPos());
+        Node *n4 = new NotNode(randomPos());
+        Link *n3n4 = new Link(n3->getOutput("out"), n4->getInput("in"));
+        Link *n1n3 = new Link(n1->getOutput("out"), n3->getInput("in"));
+        circuit.addLink(n3n4);
+        circuit.addLink(n1n3);
+        circuit.addNode(n3);
+        circuit.addNode(n4);
+    }
+}
@@ -0,0 +1,180 @@
+#include "aig.hpp"
+#include "simulator.hpp"
+#include <algorithm>
+#include <fstream>
+
+Aig::Aig(uint32_t inputCount, uint32_t latchCount)
+    : inputCount(inputCount), latchCount(latchCount), latchNext(latchCount, FALSE), latchInit(latchCount, false) {
+}
+
+uint32_t Aig::makeAnd(uint32_t a, uint32_t b) {
+    if (a > b)
+        std::swap(a, b);
+    if (a == FALSE || (a ^ 1) == b)
+        return FALSE;
+    if (a == TRUE || a == b)
+        return b;
+    uint64_t key = (uint64_t) a << 32 | b;
+    auto it = hash.find(key);
+    if (it != hash.end())
+        return it->second;
+    uint32_t literal = literalOf(1 + inputCount + latchCount + (uint32_t) ands.size());
+    ands.push_back(And{a, b});
+    hash.emplace(key, literal);
+    return literal;
+}
+
+void Aig::setLatch(uint32_t i, uint32_t next, bool init) {
+    latchNext[i] = next;
+    latchInit[i] = init;
+}
+
+Aig Aig::fromNetlist(const Netlist &net, const std::vector<uint8_t> &state, std::vector<uint32_t> *pinLiterals) {
+    constexpr uint32_t NONE = UINT32_MAX;
+    const uint32_t n = net.gateCount;
+    auto driver = [&](uint32_t pin) {
+        return pin >= net.linkBase && pin < net.floatingBase ? net.linkSrc[pin - net.linkBase] : pin;
+    };
+
+    // ---- Gates in post order, the ones a loop comes back to become latches ----
+    std::vector<uint8_t> mark(n, 0); // 1 on the stack, 2 done
+    std::vector<uint32_t> latchOf(n, NONE), order;
+    order.reserve(n);
+    uint32_t latchCount = 0;
+    std::vector<std::pair<uint32_t, uint32_t>> stack; // gate, next input
+    for (uint32_t root = 0; root < n; root++) {
+        if (mark[root])
+            continue;
+        mark[root] = 1;
+        stack.emplace_back(root, net.inputStart[root]);
+        while (!stack.empty()) {
+            uint32_t g = stack.back().first, k = stack.back().second;
+            if (k == net.inputStart[g + 1]) {
+                mark[g] = 2;
+                order.push_back(g);
+                stack.pop_back();
+                continue;
+            }
+            stack.back().second++;
+            uint32_t s = driver(net.inputPins[k]);
+            if (s >= n)
+                continue;
+            if (!mark[s]) {
+                mark[s] = 1;
+                stack.emplace_back(s, net.inputStart[s]);
+            } else if (mark[s] == 1 && latchOf[s] == NONE)
+                latchOf[s] = latchCount++;
+        }
+    }
+
+    // ---- Lower ----
+    Aig aig((uint32_t) net.circuitInputs.size(), latchCount);
+    std::vector<uint32_t> constants(net.pinCount, NONE);
+    for (uint32_t i = 0; i < net.circuitInputs.size(); i++)
+        constants[net.circuitInputs[i]] = aig.getInput(i);
+    std::vector<uint32_t> gateLiterals(n, NONE);
+    auto literalOfPin = [&](uint32_t pin) {
+        uint32_t s = driver(pin);
+        if (s < n)
+            return gateLiterals[s] != NONE ? gateLiterals[s] : aig.getLatch(latchOf[s]);
+        return constants[s] != NONE ? constants[s] : (state[s] ? TRUE : FALSE);
+    };
+    for (uint32_t g: order) {
+        const NodeOp op = net.ops[g];
+        uint32_t literal = op == NodeOp::AND ? TRUE : FALSE;
+        for (uint32_t k = net.inputStart[g]; k < net.inputStart[g + 1]; k++) {
+            uint32_t in = literalOfPin(net.inputPins[k]);
+            if (op == NodeOp::NOT)
+                literal = in ^ 1;
+            else if (op == NodeOp::AND)
+                literal = aig.makeAnd(literal, in);
+            else if (op == NodeOp::OR)
+                literal = aig.makeOr(literal, in);
+            else
+                literal = aig.makeXor(literal, in);
+        }
+        gateLiterals[g] = literal;
+    }
+    for (uint32_t g = 0; g < n; g++)
+        if (latchOf[g] != NONE)
+            aig.setLatch(latchOf[g], gateLiterals[g], state[g]);
+    for (uint32_t pin: net.circuitOutputs)
+        aig.addOutput(literalOfPin(pin));
+
+    if (pinLiterals) {
+        pinLiterals->resize(net.pinCount);
+        for (uint32_t pin = 0; pin < net.pinCount; pin++)
+            (*pinLiterals)[pin] = literalOfPin(pin);
+    }
+    return aig;
+}
+
+Aig Aig::fromCircuit(const Circuit &circuit) {
+    Simulator simulator;
+    simulator.load(circuit);
+    return fromNetlist(simulator.getNetlist(), simulator.getPins()).cleanup();
+}
+
+Aig Aig::cleanup() const {
+    const uint32_t base = 1 + inputCount + latchCount;
+    std::vector<uint8_t> used(ands.size(), 0);
+    auto use = [&](uint32_t literal) {
+        if (variableOf(literal) >= base)
+            used[variableOf(literal) - base] = 1;
+    };
+    for (uint32_t literal: outputs)
+        use(literal);
+    for (uint32_t literal: latchNext)
+        use(literal);
+    for (size_t i = ands.size(); i-- > 0;)
+        if (used[i]) {
+            use(ands[i].a);
+            use(ands[i].b);
+        }
+
+    Aig result(inputCount, latchCount);
+    std::vector<uint32_t> literals(getVariableCount());
+    for (uint32_t v = 0; v < base; v++)
+        literals[v] = literalOf(v);
+    auto map = [&](uint32_t literal) { return literals[variableOf(literal)] ^ (literal & 1); };
+    for (size_t i = 0; i < ands.size(); i++)
+        if (used[i])
+            literals[base + i] = result.makeAnd(map(ands[i].a), map(ands[i].b));
+    for (uint32_t literal: outputs)
+        result.addOutput(map(literal));
+    for (uint32_t i = 0; i < latchCount; i++)
+        result.setLatch(i, map(latchNext[i]), latchInit[i]);
+    return result;
+}
+
+void Aig::simulate(std::vector<uint64_t> &values) const {
+    const uint32_t base = 1 + inputCount + latchCount;
+    values.resize(getVariableCount());
+    values[0] = 0;
+    for (size_t i = 0; i < ands.size(); i++)
+        values[base + i] = valueOf(values, ands[i].a) & valueOf(values, ands[i].b);
+}
+
+bool Aig::writeAiger(const string &path) const {
+    std::ofstream file(path);
+    if (!file) {
+        LOGERROR("Can't write AIGER file : {}", path);
+        return false;
+    }
+    const uint32_t base = 1 + inputCount + latchCount;
+    file << "aag " << getVariableCount() - 1 << ' ' << inputCount << ' ' << latchCount << ' ' << outputs.size() << ' '
+         << ands.size() << '\n';
+    for (uint32_t i = 0; i < inputCount; i++)
+        file << getInput(i) << '\n';
+    for (uint32_t i = 0; i < latchCount; i++) {
+        file << getLatch(i) << ' ' << latchNext[i];
+        if (latchInit[i])
+            file << " 1";
+        file << '\n';
+    }
+    for (uint32_t literal: outputs)
+        file << literal << '\n';
+    for (size_t i = 0; i < ands.size(); i++)
+        file << literalOf(base + (uint32_t) i) << ' ' << ands[i].b << ' ' << ands[i].a << '\n';
+    return true;
+}
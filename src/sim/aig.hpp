@@ -0,0 +1,97 @@
+// And-inverter graph : every gate lowered to 2-input ANDs with complemented edges.
+//
+// Variables follow the AIGER numbering : 0 is constant false, then the inputs, then the latches, then the ANDs in
+// topological order. A literal is 2 * variable + complement, so an AND is stored as its two fanin literals (8 bytes)
+// and a NOT costs nothing. ANDs are hash-consed while they are built : asking twice for the same fanins returns the
+// first one, and trivial cases (constants, x & x, x & !x) never create a node.
+
+#pragma once
+
+#include "netlist.hpp"
+#include <unordered_map>
+#include <vector>
+
+class Aig {
+public:
+    struct And {
+        uint32_t a;
+        uint32_t b;
+    };
+
+    static constexpr uint32_t FALSE = 0;
+    static constexpr uint32_t TRUE = 1;
+
+    // Inputs & latches are declared first so ANDs always come after them.
+    Aig(uint32_t inputCount = 0, uint32_t latchCount = 0);
+
+    // Zero delay view of a netlist, links act as wires like in the settle engine. Gates closing a combinational
+    // loop become latches holding their current state, so a step evaluates each loop once. Inputs & outputs are the
+    // circuit inputs & outputs in node order, other sources & unconnected inputs are constants. `pinLiterals` gets
+    // the literal of every pin.
+    static Aig fromNetlist(const Netlist &net, const std::vector<uint8_t> &state,
+                           std::vector<uint32_t> *pinLiterals = nullptr);
+
+    // Compile `circuit` on the side (its own simulator is left alone), lower it & clean it up.
+    static Aig fromCircuit(const Circuit &circuit);
+
+    static uint32_t variableOf(uint32_t literal) { return literal >> 1; }
+
+    static uint32_t literalOf(uint32_t variable, bool complement = false) { return variable << 1 | complement; }
+
+    uint32_t getInput(uint32_t i) const { return literalOf(1 + i); }
+
+    uint32_t getLatch(uint32_t i) const { return literalOf(1 + inputCount + i); }
+
+    uint32_t makeAnd(uint32_t a, uint32_t b);
+
+    uint32_t makeOr(uint32_t a, uint32_t b) { return makeAnd(a ^ 1, b ^ 1) ^ 1; }
+
+    uint32_t makeXor(uint32_t a, uint32_t b) { return makeOr(makeAnd(a, b ^ 1), makeAnd(a ^ 1, b)); }
+
+    void addOutput(uint32_t literal) { outputs.push_back(literal); }
+
+    void setLatch(uint32_t i, uint32_t next, bool init);
+
+    // Only the ANDs reachable from the outputs & latches, hashed again.
+    Aig cleanup() const;
+
+    // 64 vectors per word : `values` holds one word per variable, set the inputs & latches before calling.
+    void simulate(std::vector<uint64_t> &values) const;
+
+    static uint64_t valueOf(const std::vector<uint64_t> &values, uint32_t literal) {
+        return values[literal >> 1] ^ (0 - (uint64_t) (literal & 1));
+    }
+
+    // ASCII AIGER ("aag"), latches with a set initial value get it as reset value.
+    bool writeAiger(const string &path) const;
+
+    uint32_t getInputCount() const { return inputCount; }
+
+    uint32_t getLatchCount() const { return latchCount; }
+
+    uint32_t getAndCount() const { return (uint32_t) ands.size(); }
+
+    uint32_t getVariableCount() const { return 1 + inputCount + latchCount + (uint32_t) ands.size(); }
+
+    const std::vector<And> &getAnds() const { return ands; }
+
+    const std::vector<uint32_t> &getOutputs() const { return outputs; }
+
+    const std::vector<uint32_t> &getLatchNext() const { return latchNext; }
+
+    const std::vector<bool> &getLatchInit() const { return latchInit; }
+
+    // Bytes of the graph itself, the hash table aside.
+    size_t getMemoryUsage() const {
+        return ands.size() * sizeof(And) + (outputs.size() + latchNext.size()) * sizeof(uint32_t);
+    }
+
+private:
+    uint32_t inputCount;
+    uint32_t latchCount;
+    std::vector<And> ands; // variable 1 + inputCount + latchCount + i
+    std::vector<uint32_t> outputs;
+    std::vector<uint32_t> latchNext;
+    std::vector<bool> latchInit;
+    std::unordered_map<uint64_t, uint32_t> hash; // (a << 32 | b) with a < b, to the AND literal
+};
@@ -0,0 +1,56 @@
+// Runs LaneTraits<Word>::count independent copies of a circuit at once, each pin holding one bit per copy.
+// Gates become word wide bitwise operations, so 64 (uint64_t) to 512 (Lanes512) input vectors cost one tick.
+
+#pragma once
+
+#include "gate_eval.hpp"
+#include "simulator.hpp"
+#include <vector>
+
+template<typename Word>
+class BitslicedSimulator {
+public:
+    // Every lane starts from the simulator's current state, the netlist must outlive this object.
+    explicit BitslicedSimulator(const Simulator &simulator) : netlist(simulator.getNetlist()) {
+        const std::vector<uint8_t> &state = simulator.getPins();
+        pins.resize(netlist.pinCount);
+        for (size_t i = 0; i < pins.size(); i++)
+            pins[i] = LaneTraits<Word>::fill(state[i]);
+    }
+
+    static constexpr int laneCount() { return LaneTraits<Word>::count; }
+
+    size_t getInputCount() const { return netlist.circuitInputs.size(); }
+
+    size_t getOutputCount() const { return netlist.circuitOutputs.size(); }
+
+    void setInput(size_t i, const Word &value) { pins[netlist.circuitInputs[i]] = value; }
+
+    const Word &getOutput(size_t i) const { return pins[netlist.circuitOutputs[i]]; }
+
+    Word &getPin(uint32_t pin) { return pins[pin]; }
+
+    // Copy one lane into a one byte per pin state, like Simulator::getPins().
+    void extractLane(int lane, std::vector<uint8_t> &state) const {
+        state.resize(pins.size());
+        for (size_t i = 0; i < pins.size(); i++)
+            state[i] = LaneTraits<Word>::get(pins[i], lane);
+    }
+
+    void beginUpdate() {
+        evaluateGates(netlist, pins.data());
+    }
+
+    void endUpdate() {
+        propagateLinks(netlist, pins.data());
+    }
+
+    void tick() {
+        beginUpdate();
+        endUpdate();
+    }
+
+private:
+    const Netlist &netlist;
+    std::vector<Word> pins;
+};
@@ -0,0 +1,346 @@
+#include "breakpoint.hpp"
+#include <cctype>
+#include <unordered_map>
+
+// Recursive descent straight to postfix : each rule emits its instructions after the ones of its operands.
+class Breakpoint::Parser {
+public:
+    Parser(Breakpoint &target, const std::vector<string> &names) : target(target), text(target.expression) {
+        for (uint32_t i = 0; i < names.size(); i++)
+            nameIndex.emplace(names[i], i);
+    }
+
+    bool parse() {
+        if (!parseOr())
+            return false;
+        skipSpaces();
+        if (pos < text.size())
+            return fail("unexpected '" + text.substr(pos, 1) + "' at " + std::to_string(pos));
+        return true;
+    }
+
+    const string &getError() const { return error; }
+
+private:
+    Breakpoint &target;
+    const string &text;
+    std::unordered_map<string, uint32_t> nameIndex;
+    std::unordered_map<uint32_t, uint32_t> watchOf; // name index -> watched signal
+    size_t pos = 0;
+    string error;
+
+    struct Ref {
+        uint32_t index; // in target.bus
+        uint32_t count;
+    };
+
+    bool fail(const string &message) {
+        if (error.empty())
+            error = message;
+        return false;
+    }
+
+    void skipSpaces() {
+        while (pos < text.size() && std::isspace((unsigned char) text[pos]))
+            pos++;
+    }
+
+    bool accept(const char *token) {
+        skipSpaces();
+        size_t n = std::char_traits<char>::length(token);
+        if (text.compare(pos, n, token) != 0)
+            return false;
+        pos += n;
+        return true;
+    }
+
+    void emit(Op op, uint32_t index = 0, uint32_t count = 0, uint64_t value = 0) {
+        target.program.push_back(Instruction{op, index, count, value});
+    }
+
+    bool parseOr() {
+        if (!parseAnd())
+            return false;
+        while (accept("||")) {
+            if (!parseAnd())
+                return false;
+            emit(Op::OR);
+        }
+        return true;
+    }
+
+    bool parseAnd() {
+        if (!parseCompare())
+            return false;
+        while (accept("&&")) {
+            if (!parseCompare())
+                return false;
+            emit(Op::AND);
+        }
+        return true;
+    }
+
+    bool parseCompare() {
+        if (!parseUnary())
+            return false;
+        // Two character operators first
+        static const std::pair<const char *, Op> operators[] = {{"==", Op::EQ}, {"!=", Op::NE}, {"<=", Op::LE},
+                                                               {">=", Op::GE}, {"<", Op::LT},  {">", Op::GT}};
+        for (const auto &o: operators) {
+            if (accept(o.first)) {
+                if (!parseUnary())
+                    return false;
+                emit(o.second);
+                return true;
+            }
+        }
+        return true;
+    }
+
+    bool parseUnary() {
+        if (accept("!")) {
+            if (!parseUnary())
+                return false;
+            emit(Op::NOT);
+            return true;
+        }
+        return parsePrimary();
+    }
+
+    bool parsePrimary() {
+        skipSpaces();
+        if (pos == text.size())
+            return fail("unexpected end");
+        if (accept("(")) {
+            if (!parseOr())
+                return false;
+            return accept(")") || fail("missing ')' at " + std::to_string(pos));
+        }
+        if (std::isdigit((unsigned char) text[pos]))
+            return parseNumber();
+
+        size_t start = pos;
+        string name = identifier();
+        static const std::pair<const char *, Op> functions[] = {{"rise", Op::RISE}, {"fall", Op::FALL},
+                                                               {"change", Op::CHANGE}, {"toggles", Op::TOGGLES}};
+        for (const auto &f: functions) {
+            if (name != f.first || !accept("("))
+                continue;
+            Ref ref{};
+            if (!parseSignal(ref))
+                return false;
+            if (f.second != Op::CHANGE && ref.count != 1)
+                return fail(name + "() takes a single signal");
+            if (!accept(")"))
+                return fail("missing ')' at " + std::to_string(pos));
+            emit(f.second, ref.index, ref.count);
+            target.usesToggles |= f.second == Op::TOGGLES;
+            target.usesEdges |= f.second != Op::TOGGLES;
+            return true;
+        }
+        pos = start;
+        Ref ref{};
+        if (!parseSignal(ref))
+            return false;
+        emit(Op::LOAD, ref.index, ref.count);
+        return true;
+    }
+
+    bool parseNumber() {
+        int base = 10;
+        if (accept("0x") || accept("0X"))
+            base = 16;
+        else if (accept("0b") || accept("0B"))
+            base = 2;
+        size_t start = pos;
+        uint64_t value = 0;
+        while (pos < text.size() && std::isxdigit((unsigned char) text[pos])) {
+            int digit = std::isdigit((unsigned char) text[pos]) ? text[pos] - '0'
+                                                                : std::tolower((unsigned char) text[pos]) - 'a' + 10;
+            if (digit >= base)
+                break;
+            value = value * base + digit;
+            pos++;
+        }
+        if (pos == start)
+            return fail("bad number at " + std::to_string(start));
+        emit(Op::CONST, 0, 0, value);
+        return true;
+    }
+
+    // Names may hold dots, $ and [n] indices
+    string identifier() {
+        skipSpaces();
+        size_t start = pos;
+        while (pos < text.size()) {
+            char c = text[pos];
+            if (std::isalnum((unsigned char) c) || c == '_' || c == '.' || c == '$')
+                pos++;
+            else if (c == '[' && pos > start) {
+                size_t end = text.find(']', pos);
+                if (end == string::npos)
+                    break;
+                pos = end + 1;
+            } else
+                break;
+        }
+        return text.substr(start, pos - start);
+    }
+
+    // A name, a bus of name[i] signals or {a, b, ...}, appended to target.bus
+    bool parseSignal(Ref &ref) {
+        ref = Ref{(uint32_t) target.bus.size(), 0};
+        if (accept("{")) {
+            do {
+                if (!appendSignal())
+                    return false;
+            } while (accept(","));
+            if (!accept("}"))
+                return fail("missing '}' at " + std::to_string(pos));
+        } else if (!appendSignal())
+            return false;
+        ref.count = (uint32_t) target.bus.size() - ref.index;
+        if (ref.count > 64)
+            return fail("buses are 64 bits at most");
+        return true;
+    }
+
+    bool appendSignal() {
+        size_t start = pos;
+        string name = identifier();
+        if (name.empty())
+            return fail("expected a signal at " + std::to_string(start));
+        auto it = nameIndex.find(name);
+        if (it != nameIndex.end()) {
+            target.bus.push_back(watch(it->second));
+            return true;
+        }
+        std::vector<uint32_t> bits;
+        for (auto bit = nameIndex.find(name + "[0]"); bit != nameIndex.end();
+             bit = nameIndex.find(name + "[" + std::to_string(bits.size()) + "]"))
+            bits.push_back(watch(bit->second));
+        if (bits.empty())
+            return fail("unknown signal " + name);
+        target.bus.insert(target.bus.end(), bits.rbegin(), bits.rend());
+        return true;
+    }
+
+    uint32_t watch(uint32_t name) {
+        auto it = watchOf.find(name);
+        if (it != watchOf.end())
+            return it->second;
+        uint32_t signal = (uint32_t) target.signals.size();
+        target.signals.push_back(name);
+        watchOf.emplace(name, signal);
+        return signal;
+    }
+};
+
+bool Breakpoint::compile(const string &text, const std::vector<string> &names) {
+    expression = text;
+    program.clear();
+    signals.clear();
+    bus.clear();
+    usesToggles = false;
+    usesEdges = false;
+    Parser parser(*this, names);
+    if (!parser.parse()) {
+        LOGERROR("Breakpoint \"{}\" : {}", text, parser.getError());
+        program.clear();
+        return false;
+    }
+    watched.assign(signals.size(), NO_PIN);
+    previous.assign(signals.size(), 0);
+    current.assign(signals.size(), 0);
+    toggles.assign(signals.size(), 0);
+    return true;
+}
+
+void Breakpoint::setPins(const std::vector<uint32_t> &signalPins, const uint8_t *pins) {
+    watched = signalPins;
+    watched.resize(signals.size(), NO_PIN);
+    arm(pins);
+}
+
+void Breakpoint::arm(const uint8_t *pins) {
+    for (size_t i = 0; i < watched.size(); i++)
+        current[i] = watched[i] == NO_PIN ? 0 : pins[watched[i]];
+    previous = current;
+    wasTrue = run();
+}
+
+bool Breakpoint::check(const uint8_t *pins) {
+    bool changed = false;
+    for (size_t i = 0; i < watched.size(); i++) {
+        uint8_t value = watched[i] == NO_PIN ? 0 : pins[watched[i]];
+        current[i] = value;
+        if (value != previous[i]) {
+            toggles[i]++;
+            changed = true;
+        }
+    }
+    // Edges turn false on a quiet tick, which must be seen for the next one to fire (previous == current here)
+    if (!changed) {
+        if (usesEdges)
+            wasTrue = run();
+        return false;
+    }
+    bool now = run();
+    previous.swap(current);
+    bool fired = now && !wasTrue;
+    wasTrue = now;
+    return fired;
+}
+
+bool Breakpoint::run() {
+    stack.clear();
+    for (const Instruction &in: program) {
+        const uint32_t *bits = bus.data() + in.index;
+        switch (in.op) {
+            case Op::CONST:
+                stack.push_back(in.value);
+                continue;
+            case Op::LOAD: {
+                uint64_t value = 0;
+                for (uint32_t i = 0; i < in.count; i++)
+                    value = value << 1 | current[bits[i]];
+                stack.push_back(value);
+            } continue;
+            case Op::RISE:
+                stack.push_back(!previous[bits[0]] && current[bits[0]]);
+                continue;
+            case Op::FALL:
+                stack.push_back(previous[bits[0]] && !current[bits[0]]);
+                continue;
+            case Op::CHANGE: {
+                bool changed = false;
+                for (uint32_t i = 0; i < in.count; i++)
+                    changed |= previous[bits[i]] != current[bits[i]];
+                stack.push_back(changed);
+            } continue;
+            case Op::TOGGLES:
+                stack.push_back(toggles[bits[0]]);
+                continue;
+            case Op::NOT:
+                stack.back() = !stack.back();
+                continue;
+            default:
+                break;
+        }
+        uint64_t b = stack.back();
+        stack.pop_back();
+        uint64_t &a = stack.back();
+        switch (in.op) {
+            case Op::EQ: a = a == b; break;
+            case Op::NE: a = a != b; break;
+            case Op::LT: a = a < b; break;
+            case Op::GT: a = a > b; break;
+            case Op::LE: a = a <= b; break;
+            case Op::GE: a = a >= b; break;
+            case Op::AND: a = a && b; break;
+            case Op::OR: a = a || b; break;
+            default: break;
+        }
+    }
+    return !stack.empty() && stack.back() != 0;
+}
@@ -0,0 +1,87 @@
+// Conditions that stop the simulation on the exact tick they become true.
+//
+// An expression is compiled once into a small stack program over the signals it names, and the simulator only runs
+// it after ticks where one of those signals changed, so a breakpoint costs a compare per watched signal per tick.
+//
+//   a                        a signal, or the bus a[n-1]..a[0] when the signals are named a[0], a[1]...
+//   {a, b, c}                a bus, most significant bit first (64 bits at most)
+//   rise(a) fall(a)          an edge of a single signal on this tick
+//   change(a)                any bit of a signal or bus changed on this tick
+//   toggles(a)               changes of a signal since the breakpoint was set
+//   == != < > <= >= ! && || ( ), decimal, 0x & 0b literals
+//
+// e.g. "rise(clk) && count == 0x3F", "toggles(q) == 1000". A breakpoint fires when its value goes from false to
+// true, not on every tick it stays true.
+
+#pragma once
+
+#include "core/defines.hpp"
+#include <cstdint>
+#include <vector>
+
+class Breakpoint {
+public:
+    static constexpr uint32_t NO_PIN = 0xFFFFFFFF;
+
+    // False (logged) when `expression` doesn't compile. `names` are the signals it may read.
+    bool compile(const string &expression, const std::vector<string> &names);
+
+    const string &getExpression() const { return expression; }
+
+    // Indices in `names` of the signals the program reads, in watch order.
+    const std::vector<uint32_t> &getSignals() const { return signals; }
+
+    // toggles() counts keep growing in a periodic state, so skipping periods would miss them.
+    bool countsToggles() const { return usesToggles; }
+
+    // Pin of each watched signal, NO_PIN reads 0. Arms the breakpoint on the current state.
+    void setPins(const std::vector<uint32_t> &signalPins, const uint8_t *pins);
+
+    // Take the current state as the reference again after it was changed from outside the ticks.
+    void arm(const uint8_t *pins);
+
+    // After a tick, true when the condition just became true.
+    bool check(const uint8_t *pins);
+
+private:
+    enum class Op : uint8_t {
+        CONST,
+        LOAD,    // bus of `count` watched signals from `index`
+        RISE,
+        FALL,
+        CHANGE,
+        TOGGLES,
+        NOT,
+        EQ,
+        NE,
+        LT,
+        GT,
+        LE,
+        GE,
+        AND,
+        OR
+    };
+    struct Instruction {
+        Op op;
+        uint32_t index = 0;
+        uint32_t count = 0;
+        uint64_t value = 0;
+    };
+
+    string expression;
+    std::vector<Instruction> program;
+    std::vector<uint32_t> signals;
+    std::vector<uint32_t> bus;      // watched signal per bus bit, LOADs index it, most significant first
+    std::vector<uint32_t> watched;  // pin per watched signal
+    std::vector<uint8_t> previous;  // values after the previous check
+    std::vector<uint8_t> current;
+    std::vector<uint64_t> toggles;
+    std::vector<uint64_t> stack;
+    bool usesToggles = false;
+    bool usesEdges = false; // rise, fall or change
+    bool wasTrue = false;
+
+    class Parser;
+
+    bool run();
+};
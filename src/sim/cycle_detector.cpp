@@ -0,0 +1,40 @@
+#include "cycle_detector.hpp"
+#include "packed_state.hpp"
+#include <cstring>
+
+void CycleDetector::reset() {
+    status = CycleStatus::SEARCHING;
+    hasTortoise = false;
+    power = 1;
+    distance = 0;
+    period = 0;
+}
+
+bool CycleDetector::observe(const uint8_t *pins, uint32_t count, uint64_t tick) {
+    if (status != CycleStatus::SEARCHING)
+        return false;
+    packPins(pins, count, current);
+    uint64_t hash = hashPacked(current);
+    if (!hasTortoise) {
+        tortoise.swap(current);
+        tortoiseHash = hash;
+        hasTortoise = true;
+        return false;
+    }
+
+    distance++;
+    if (hash == tortoiseHash && current.size() == tortoise.size() &&
+        !std::memcmp(current.data(), tortoise.data(), current.size() * sizeof(uint64_t))) {
+        period = distance;
+        status = period == 1 ? CycleStatus::SETTLED : CycleStatus::PERIODIC;
+        detectionTick = tick;
+        return true;
+    }
+    if (distance == power) {
+        tortoise.swap(current);
+        tortoiseHash = hash;
+        power *= 2;
+        distance = 0;
+    }
+    return false;
+}
@@ -0,0 +1,45 @@
+// Detects when the state between two ticks starts repeating : a fixed point (period 1) or a cycle of period P.
+//
+// Brent's algorithm over the packed pin states : a single saved state (the "tortoise"), compared by hash every
+// tick and confirmed with a full compare, moved forward at powers of two. Memory stays one packed state whatever
+// the period, and the period is found within a few times its length after the circuit entered the cycle.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+enum class CycleStatus {
+    SEARCHING,
+    SETTLED,  // fixed point, ticks change nothing anymore
+    PERIODIC  // the state repeats every getPeriod() ticks
+};
+
+class CycleDetector {
+public:
+    // Forget everything, needed whenever the state is changed from outside the ticks.
+    void reset();
+
+    // State after a tick. Returns true when this call detected the cycle.
+    bool observe(const uint8_t *pins, uint32_t count, uint64_t tick);
+
+    CycleStatus getStatus() const { return status; }
+
+    bool isDetected() const { return status != CycleStatus::SEARCHING; }
+
+    uint64_t getPeriod() const { return period; }
+
+    // Tick at which the cycle was confirmed.
+    uint64_t getDetectionTick() const { return detectionTick; }
+
+private:
+    CycleStatus status = CycleStatus::SEARCHING;
+    std::vector<uint64_t> tortoise;
+    std::vector<uint64_t> current;
+    uint64_t tortoiseHash = 0;
+    bool hasTortoise = false;
+    uint64_t power = 1;
+    uint64_t distance = 0; // ticks since the tortoise was saved
+    uint64_t period = 0;
+    uint64_t detectionTick = 0;
+};
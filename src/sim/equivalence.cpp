@@ -0,0 +1,341 @@
+#include "equivalence.hpp"
+#include "sat_solver.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+
+constexpr uint32_t NONE = UINT32_MAX;
+
+// Verdicts on candidates, shared by the threads so each one is decided once
+enum Verdict : uint8_t {
+    OPEN,
+    CLAIMED, // a thread is on it
+    PROVED,
+    DROPPED  // refuted, or past its conflict budget
+};
+
+uint64_t splitmix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// Both graphs over shared inputs : outputs of `a` first, then the ones of `b`
+Aig buildMiter(const Aig &a, const Aig &b) {
+    Aig miter(a.getInputCount(), 0);
+    for (const Aig *side: {&a, &b}) {
+        const uint32_t base = 1 + side->getInputCount();
+        std::vector<uint32_t> literals(side->getVariableCount());
+        for (uint32_t v = 0; v < base; v++)
+            literals[v] = Aig::literalOf(v);
+        auto map = [&](uint32_t literal) { return literals[literal >> 1] ^ (literal & 1); };
+        const std::vector<Aig::And> &ands = side->getAnds();
+        for (size_t i = 0; i < ands.size(); i++)
+            literals[base + i] = miter.makeAnd(map(ands[i].a), map(ands[i].b));
+        for (uint32_t literal: side->getOutputs())
+            miter.addOutput(map(literal));
+    }
+    return miter;
+}
+
+// One thread proving output pairs, keeps its solver & what it learnt from one pair to the next. Candidates another
+// thread proved come in as clauses, the ones it is still on are left out of this output's proof.
+class Prover {
+public:
+    Prover(const Aig &miter, const std::vector<uint32_t> &representatives, std::atomic<uint8_t> *verdicts,
+           const EquivalenceOptions &options)
+        : miter(miter), representatives(representatives), verdicts(verdicts), options(options),
+          encoded(miter.getVariableCount(), 0), decided(miter.getVariableCount(), 0),
+          coneMark(miter.getVariableCount(), NONE), patternInputs(miter.getInputCount(), 0) {
+        reset();
+    }
+
+    // SAT when the outputs `k` differ, the inputs showing it go to `counterexample`
+    SatSolver::Result prove(uint32_t k, const std::atomic<bool> &stop, std::vector<bool> &counterexample) {
+        const uint32_t outputCount = (uint32_t) miter.getOutputs().size() / 2;
+        const uint32_t x = miter.getOutputs()[k], y = miter.getOutputs()[outputCount + k];
+        if (x == y)
+            return SatSolver::Result::UNSAT;
+
+        // Candidates of both cones, fanins first
+        const uint32_t base = 1 + miter.getInputCount();
+        std::vector<uint32_t> cone, stack{x >> 1, y >> 1};
+        while (!stack.empty()) {
+            uint32_t v = stack.back();
+            stack.pop_back();
+            if (v < base || coneMark[v] == k)
+                continue;
+            coneMark[v] = k;
+            cone.push_back(v);
+            stack.push_back(miter.getAnds()[v - base].a >> 1);
+            stack.push_back(miter.getAnds()[v - base].b >> 1);
+        }
+        std::sort(cone.begin(), cone.end());
+        if (encodedCount > 2 * cone.size() + 256)
+            reset();
+        for (uint32_t v: cone) {
+            uint32_t r = representatives[v];
+            if (r == NONE || decided[v] || stop)
+                continue;
+            uint32_t literal = Aig::literalOf(v);
+            uint8_t verdict = OPEN;
+            if (!verdicts[v].compare_exchange_strong(verdict, CLAIMED)) {
+                if (verdict != CLAIMED)
+                    decided[v] = 1;
+                if (verdict == PROVED)
+                    merge(literal, r);
+                continue;
+            }
+            decided[v] = 1;
+            if (distinguished(literal, r)) {
+                refuted++;
+                verdicts[v] = DROPPED;
+                continue;
+            }
+            SatSolver::Result result = differ(literal, r, options.candidateConflicts);
+            if (result == SatSolver::Result::UNSAT) {
+                proved++;
+                merge(literal, r);
+            } else if (result == SatSolver::Result::SAT) {
+                refuted++;
+                addPattern();
+            }
+            verdicts[v] = result == SatSolver::Result::UNSAT ? PROVED : DROPPED;
+        }
+        if (stop)
+            return SatSolver::Result::UNKNOWN;
+
+        uint64_t split = patternCount ? (Aig::valueOf(patternValues, x) ^ Aig::valueOf(patternValues, y)) & patternMask() : 0;
+        if (split) {
+            int bit = __builtin_ctzll(split);
+            counterexample.resize(miter.getInputCount());
+            for (uint32_t i = 0; i < miter.getInputCount(); i++)
+                counterexample[i] = patternInputs[i] >> bit & 1;
+            return SatSolver::Result::SAT;
+        }
+        SatSolver::Result result = differ(x, y, options.outputConflicts);
+        if (result == SatSolver::Result::SAT) {
+            counterexample.resize(miter.getInputCount());
+            for (uint32_t i = 0; i < miter.getInputCount(); i++)
+                counterexample[i] = solver.modelValue(1 + i);
+        }
+        return result;
+    }
+
+    uint32_t proved = 0;
+    uint32_t refuted = 0;
+    uint32_t satCalls = 0;
+
+private:
+    const Aig &miter;
+    const std::vector<uint32_t> &representatives;
+    std::atomic<uint8_t> *verdicts;
+    const EquivalenceOptions &options;
+    SatSolver solver;
+    std::vector<uint8_t> encoded;
+    uint32_t encodedCount = 0;
+    std::vector<uint8_t> decided;
+    std::vector<uint32_t> coneMark;
+    // Up to 64 vectors found by the solver, simulated over the whole miter
+    std::vector<uint64_t> patternInputs;
+    std::vector<uint64_t> patternValues;
+    uint32_t patternCount = 0;
+
+    uint64_t patternMask() const { return patternCount >= 64 ? ~0ull : (1ull << patternCount) - 1; }
+
+    bool distinguished(uint32_t x, uint32_t y) const {
+        return patternCount && ((Aig::valueOf(patternValues, x) ^ Aig::valueOf(patternValues, y)) & patternMask());
+    }
+
+    void addPattern() {
+        if (patternCount == 64) {
+            std::fill(patternInputs.begin(), patternInputs.end(), 0);
+            patternCount = 0;
+        }
+        for (uint32_t i = 0; i < miter.getInputCount(); i++)
+            patternInputs[i] |= (uint64_t) solver.modelValue(1 + i) << patternCount;
+        patternCount++;
+        patternValues.assign(miter.getVariableCount(), 0);
+        std::copy(patternInputs.begin(), patternInputs.end(), patternValues.begin() + 1);
+        miter.simulate(patternValues);
+    }
+
+    // Start over once most of the solver is out of the cones at hand, the proved candidates come back as clauses
+    void reset() {
+        solver = SatSolver();
+        solver.reserveVars(miter.getVariableCount());
+        solver.addClause({Aig::TRUE}); // variable 0 is false
+        std::fill(encoded.begin(), encoded.end(), 0);
+        std::fill(decided.begin(), decided.end(), 0);
+        encoded[0] = 1;
+        encodedCount = 1;
+    }
+
+    void merge(uint32_t x, uint32_t y) {
+        solver.addClause({x ^ 1, y});
+        solver.addClause({x, y ^ 1});
+    }
+
+    // Tseitin clauses of the cone of `var`
+    void encode(uint32_t var) {
+        const uint32_t base = 1 + miter.getInputCount();
+        std::vector<uint32_t> stack{var};
+        while (!stack.empty()) {
+            uint32_t v = stack.back();
+            if (encoded[v]) {
+                stack.pop_back();
+                continue;
+            }
+            if (v < base) {
+                encoded[v] = 1;
+                encodedCount++;
+                stack.pop_back();
+                continue;
+            }
+            const Aig::And &node = miter.getAnds()[v - base];
+            if (!encoded[node.a >> 1] || !encoded[node.b >> 1]) {
+                stack.push_back(node.a >> 1);
+                stack.push_back(node.b >> 1);
+                continue;
+            }
+            uint32_t z = Aig::literalOf(v);
+            solver.addClause({z ^ 1, node.a});
+            solver.addClause({z ^ 1, node.b});
+            solver.addClause({z, node.a ^ 1, node.b ^ 1});
+            encoded[v] = 1;
+            encodedCount++;
+            stack.pop_back();
+        }
+    }
+
+    // Can `x` and `y` differ ? A fresh selector enables the XOR for this query only.
+    SatSolver::Result differ(uint32_t x, uint32_t y, uint64_t conflictLimit) {
+        encode(x >> 1);
+        encode(y >> 1);
+        uint32_t selector = Aig::literalOf(solver.newVar());
+        solver.addClause({selector ^ 1, x, y});
+        solver.addClause({selector ^ 1, x ^ 1, y ^ 1});
+        satCalls++;
+        SatSolver::Result result = solver.solve({selector}, conflictLimit);
+        solver.addClause({selector ^ 1}); // the model stays readable
+        return result;
+    }
+};
+
+}
+
+EquivalenceResult checkEquivalence(const Aig &a, const Aig &b, const EquivalenceOptions &options) {
+    EquivalenceResult result;
+    if (a.getInputCount() != b.getInputCount() || a.getOutputs().size() != b.getOutputs().size()) {
+        LOGERROR("Circuits to compare differ in inputs or outputs, inputs {} / {}, outputs {} / {}", a.getInputCount(),
+                 b.getInputCount(), a.getOutputs().size(), b.getOutputs().size());
+        return result;
+    }
+    if (a.getLatchCount() || b.getLatchCount()) {
+        LOGERROR("Equivalence checking needs loop free circuits, latches : {}", a.getLatchCount() + b.getLatchCount());
+        return result;
+    }
+    const Aig miter = buildMiter(a, b);
+    const uint32_t inputCount = miter.getInputCount();
+    const uint32_t outputCount = (uint32_t) a.getOutputs().size();
+    const uint32_t variableCount = miter.getVariableCount();
+    const uint32_t base = 1 + inputCount;
+    const uint32_t words = std::max(options.randomWords, 1u);
+    ThreadPool pool(options.threads ? options.threads : ThreadPool::getHardwareThreads());
+    const uint32_t threads = pool.getThreadCount();
+
+    // ---- Random simulation, words split across threads ----
+    std::vector<uint64_t> values((size_t) variableCount * words, 0);
+    pool.run([&](uint32_t worker) {
+        const uint32_t first = words * worker / threads, last = words * (worker + 1) / threads;
+        for (uint32_t i = 0; i < inputCount; i++)
+            for (uint32_t w = first; w < last; w++)
+                values[(size_t) (1 + i) * words + w] = splitmix((uint64_t) i * words + w);
+        auto word = [&](uint32_t literal, uint32_t w) {
+            return values[(size_t) (literal >> 1) * words + w] ^ (0 - (uint64_t) (literal & 1));
+        };
+        const std::vector<Aig::And> &ands = miter.getAnds();
+        for (size_t i = 0; i < ands.size(); i++)
+            for (uint32_t w = first; w < last; w++)
+                values[(size_t) (base + i) * words + w] = word(ands[i].a, w) & word(ands[i].b, w);
+    });
+    auto word = [&](uint32_t literal, uint32_t w) {
+        return values[(size_t) (literal >> 1) * words + w] ^ (0 - (uint64_t) (literal & 1));
+    };
+    for (uint32_t k = 0; k < outputCount; k++)
+        for (uint32_t w = 0; w < words; w++) {
+            uint64_t split = word(miter.getOutputs()[k], w) ^ word(miter.getOutputs()[outputCount + k], w);
+            if (!split)
+                continue;
+            int bit = __builtin_ctzll(split);
+            result.status = EquivalenceResult::Status::DIFFERENT;
+            result.output = k;
+            for (uint32_t i = 0; i < inputCount; i++)
+                result.counterexample.push_back(values[(size_t) (1 + i) * words + w] >> bit & 1);
+            return result;
+        }
+
+    // ---- Candidate classes : same values, complemented when the first vector is 1 ----
+    std::vector<uint32_t> representatives(variableCount, NONE);
+    std::unordered_map<uint64_t, uint32_t> classes;
+    for (uint32_t v = 0; v < variableCount; v++) {
+        const uint64_t *signature = &values[(size_t) v * words];
+        const uint64_t flip = 0 - (signature[0] & 1);
+        uint64_t hash = 0xCBF29CE484222325ull;
+        for (uint32_t w = 0; w < words; w++)
+            hash = splitmix(hash ^ signature[w] ^ flip);
+        auto it = classes.emplace(hash, v);
+        if (it.second || v < base)
+            continue;
+        uint32_t r = it.first->second;
+        const uint64_t *other = &values[(size_t) r * words];
+        const uint64_t otherFlip = 0 - (other[0] & 1);
+        bool same = true;
+        for (uint32_t w = 0; w < words && same; w++)
+            same = (signature[w] ^ flip) == (other[w] ^ otherFlip);
+        if (same) {
+            representatives[v] = Aig::literalOf(r, flip != otherFlip);
+            result.candidates++;
+        }
+    }
+    std::vector<uint64_t>().swap(values);
+
+    // ---- Proofs, output pairs handed out to the threads ----
+    std::atomic<uint32_t> nextOutput{0};
+    std::atomic<bool> stop{false};
+    std::unique_ptr<std::atomic<uint8_t>[]> verdicts(new std::atomic<uint8_t>[variableCount]());
+    std::mutex mutex;
+    bool undecided = false;
+    pool.run([&](uint32_t) {
+        Prover prover(miter, representatives, verdicts.get(), options);
+        std::vector<bool> counterexample;
+        for (uint32_t k; !stop && (k = nextOutput++) < outputCount;) {
+            SatSolver::Result proof = prover.prove(k, stop, counterexample);
+            if (proof == SatSolver::Result::SAT) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!stop) {
+                    result.status = EquivalenceResult::Status::DIFFERENT;
+                    result.output = k;
+                    result.counterexample = counterexample;
+                    stop = true;
+                }
+            } else if (proof == SatSolver::Result::UNKNOWN && !stop) {
+                std::lock_guard<std::mutex> lock(mutex);
+                undecided = true;
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        result.proved += prover.proved;
+        result.refuted += prover.refuted;
+        result.satCalls += prover.satCalls;
+    });
+    if (!stop)
+        result.status = undecided ? EquivalenceResult::Status::UNDECIDED : EquivalenceResult::Status::EQUIVALENT;
+    return result;
+}
@@ -0,0 +1,40 @@
+// Combinational equivalence checking of two and-inverter graphs (see sim/aig.hpp).
+//
+// Both graphs go into one miter, which already merges their identical structure through hashing. Random vectors,
+// 64 per word and split across threads, then group the remaining signals into candidate classes : signals with the
+// same values (or complemented ones) on every vector. Each thread takes output pairs in turn and proves the
+// candidates of their cones in topological order with its own SAT solver (see sim/sat_solver.hpp). A proved pair adds
+// its equality as clauses, which keeps the final output queries small, and a refuted one gives a new vector that
+// splits the other candidates. Any output pair that differs gives the input vector showing it.
+
+#pragma once
+
+#include "aig.hpp"
+#include <vector>
+
+struct EquivalenceOptions {
+    uint32_t threads = 0;          // 0 uses every hardware thread
+    uint32_t randomWords = 64;     // random vectors, in words of 64
+    uint64_t candidateConflicts = 1000; // SAT budget to prove an internal candidate, it is skipped past that
+    uint64_t outputConflicts = 0;  // SAT budget per output pair, 0 for no limit
+};
+
+struct EquivalenceResult {
+    enum class Status {
+        EQUIVALENT,
+        DIFFERENT,
+        UNDECIDED,   // an output ran out of conflicts
+        INCOMPATIBLE // different input or output counts, or latches
+    };
+
+    Status status = Status::INCOMPATIBLE;
+    uint32_t output = 0;              // output that differs
+    std::vector<bool> counterexample; // per input, when DIFFERENT
+    uint32_t candidates = 0;          // signals with a candidate equivalent after simulation
+    uint32_t proved = 0;
+    uint32_t refuted = 0;
+    uint32_t satCalls = 0;
+};
+
+// Outputs are compared pairwise, in order. Only combinational graphs (no latch) are checked.
+EquivalenceResult checkEquivalence(const Aig &a, const Aig &b, const EquivalenceOptions &options = {});
@@ -0,0 +1,79 @@
+#include "event_engine.hpp"
+#include "gate_eval.hpp"
+
+void EventEngine::build(const Netlist &netlist) {
+    net = &netlist;
+    netlist.buildLinkFanout(linkFanoutStart, linkFanout);
+    netlist.buildGateFanout(gateFanoutStart, gateFanout);
+
+    gateQueued.assign(netlist.gateCount, 0);
+    linkQueued.assign(netlist.linkSrc.size(), 0);
+    gateQueue.clear();
+    linkQueue.clear();
+    gateQueue.reserve(netlist.gateCount);
+    linkQueue.reserve(netlist.linkSrc.size());
+    scheduleAll();
+}
+
+void EventEngine::scheduleAll() {
+    for (uint32_t g = 0; g < net->gateCount; g++)
+        scheduleGate(g);
+    for (uint32_t j = 0; j < net->linkSrc.size(); j++) {
+        if (!linkQueued[j]) {
+            linkQueued[j] = 1;
+            linkQueue.push_back(j);
+        }
+    }
+}
+
+void EventEngine::pinChanged(uint32_t pin) {
+    scheduleLinks(pin);
+    for (uint32_t k = gateFanoutStart[pin]; k < gateFanoutStart[pin + 1]; k++)
+        scheduleGate(gateFanout[k]);
+}
+
+void EventEngine::scheduleGate(uint32_t gate) {
+    if (!gateQueued[gate]) {
+        gateQueued[gate] = 1;
+        gateQueue.push_back(gate);
+    }
+}
+
+void EventEngine::scheduleLinks(uint32_t pin) {
+    for (uint32_t k = linkFanoutStart[pin]; k < linkFanoutStart[pin + 1]; k++) {
+        uint32_t j = linkFanout[k];
+        if (!linkQueued[j]) {
+            linkQueued[j] = 1;
+            linkQueue.push_back(j);
+        }
+    }
+}
+
+void EventEngine::beginUpdate(uint8_t *p) {
+    lastActivity = (uint32_t) gateQueue.size();
+    for (uint32_t g: gateQueue) {
+        gateQueued[g] = 0;
+        uint8_t value = evaluateGate(*net, p, g);
+        if (value != p[g]) {
+            p[g] = value;
+            scheduleLinks(g);
+        }
+    }
+    gateQueue.clear();
+}
+
+void EventEngine::endUpdate(uint8_t *p) {
+    uint8_t *dst = p + net->linkBase;
+    const uint32_t *src = net->linkSrc.data();
+    for (uint32_t j: linkQueue) {
+        linkQueued[j] = 0;
+        uint8_t value = p[src[j]];
+        if (value != dst[j]) {
+            dst[j] = value;
+            uint32_t pin = net->linkBase + j;
+            for (uint32_t k = gateFanoutStart[pin]; k < gateFanoutStart[pin + 1]; k++)
+                scheduleGate(gateFanout[k]);
+        }
+    }
+    linkQueue.clear();
+}
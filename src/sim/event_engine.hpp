@@ -0,0 +1,46 @@
+// Activity based evaluation : only gates whose inputs changed during the previous tick are evaluated,
+// and only links whose source changed are copied. Gives the same states as evaluating everything.
+
+#pragma once
+
+#include "netlist.hpp"
+#include <cstdint>
+#include <vector>
+
+class EventEngine {
+public:
+    // Build fan-out tables, every gate & link is scheduled for the next tick.
+    void build(const Netlist &net);
+
+    // Schedule everything, needed whenever pins are written from outside the engine.
+    void scheduleAll();
+
+    // A pin was written from outside the engine.
+    void pinChanged(uint32_t pin);
+
+    void beginUpdate(uint8_t *pins);
+
+    void endUpdate(uint8_t *pins);
+
+    // Gates evaluated by the last beginUpdate.
+    uint32_t getLastActivity() const { return lastActivity; }
+
+private:
+    const Netlist *net = nullptr;
+
+    // pin -> links copying it, pin -> gates reading it (CSR)
+    std::vector<uint32_t> linkFanoutStart;
+    std::vector<uint32_t> linkFanout;
+    std::vector<uint32_t> gateFanoutStart;
+    std::vector<uint32_t> gateFanout;
+
+    std::vector<uint32_t> gateQueue;
+    std::vector<uint32_t> linkQueue;
+    std::vector<uint8_t> gateQueued;
+    std::vector<uint8_t> linkQueued;
+    uint32_t lastActivity = 0;
+
+    void scheduleGate(uint32_t gate);
+
+    void scheduleLinks(uint32_t pin);
+};
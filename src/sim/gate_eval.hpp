@@ -0,0 +1,52 @@
+// Gate & link passes shared by every engine working on a Netlist, for any lane word.
+
+#pragma once
+
+#include "lanes.hpp"
+#include "netlist.hpp"
+
+// Gates of the same op are contiguous inside each partition, each loop has a fixed arity.
+template<typename Word>
+void evaluateGates(const Netlist &net, Word *p) {
+    const uint32_t *in = net.inputPins.data();
+    const uint32_t *start = net.inputStart.data();
+    const Word ones = LaneTraits<Word>::fill(true);
+
+    for (uint32_t k = 0; k < net.partitionCount; k++) {
+        for (uint32_t g = net.opBegin(k, NodeOp::NOT); g < net.opEnd(k, NodeOp::NOT); g++)
+            p[g] = p[in[start[g]]] ^ ones;
+        for (uint32_t g = net.opBegin(k, NodeOp::AND); g < net.opEnd(k, NodeOp::AND); g++)
+            p[g] = p[in[start[g]]] & p[in[start[g] + 1]];
+        for (uint32_t g = net.opBegin(k, NodeOp::OR); g < net.opEnd(k, NodeOp::OR); g++)
+            p[g] = p[in[start[g]]] | p[in[start[g] + 1]];
+        for (uint32_t g = net.opBegin(k, NodeOp::XOR); g < net.opEnd(k, NodeOp::XOR); g++)
+            p[g] = p[in[start[g]]] ^ p[in[start[g] + 1]];
+    }
+}
+
+template<typename Word>
+void propagateLinks(const Netlist &net, Word *p) {
+    Word *dst = p + net.linkBase;
+    const uint32_t *src = net.linkSrc.data();
+    int n = (int) net.linkSrc.size();
+    for (int j = 0; j < n; j++)
+        dst[j] = p[src[j]];
+}
+
+// Single gate, for engines that walk gates in their own order.
+template<typename Word>
+inline Word evaluateGate(const Netlist &net, const Word *p, uint32_t g) {
+    const uint32_t *i = net.inputPins.data() + net.inputStart[g];
+    switch (net.ops[g]) {
+        case NodeOp::NOT:
+            return p[i[0]] ^ LaneTraits<Word>::fill(true);
+        case NodeOp::AND:
+            return p[i[0]] & p[i[1]];
+        case NodeOp::OR:
+            return p[i[0]] | p[i[1]];
+        case NodeOp::XOR:
+            return p[i[0]] ^ p[i[1]];
+        default:
+            return p[g];
+    }
+}
@@ -0,0 +1,102 @@
+#include "history.hpp"
+#include "packed_state.hpp"
+
+size_t StateHistory::Segment::memory() const {
+    return sizeof(Segment) + keyframe.size() * sizeof(uint64_t) + deltaStart.size() * sizeof(uint32_t) +
+           words.size() * (sizeof(uint32_t) + sizeof(uint64_t));
+}
+
+void StateHistory::Segment::rebuild(uint64_t tick, std::vector<uint64_t> &state) const {
+    state = keyframe;
+    for (uint64_t k = 0; k < tick - firstTick; k++)
+        for (uint32_t i = deltaStart[k]; i < deltaStart[k + 1]; i++)
+            state[words[i]] ^= xors[i];
+}
+
+void StateHistory::setBudget(size_t b) {
+    budget = b;
+    if (!budget)
+        clear();
+    while (bytes > budget && segments.size() > 1) {
+        bytes -= segments.front().memory();
+        segments.pop_front();
+    }
+}
+
+void StateHistory::clear() {
+    segments.clear();
+    last.clear();
+    bytes = 0;
+}
+
+const StateHistory::Segment *StateHistory::find(uint64_t tick) const {
+    if (!contains(tick))
+        return nullptr;
+    for (auto s = segments.rbegin(); s != segments.rend(); ++s)
+        if (s->firstTick <= tick)
+            return &*s;
+    return nullptr;
+}
+
+void StateHistory::truncate(uint64_t tick) {
+    while (!segments.empty() && segments.back().firstTick > tick) {
+        bytes -= segments.back().memory();
+        segments.pop_back();
+    }
+    Segment &s = segments.back();
+    bytes -= s.memory();
+    s.deltaStart.resize(tick - s.firstTick + 1);
+    s.words.resize(s.deltaStart.back());
+    s.xors.resize(s.deltaStart.back());
+    bytes += s.memory();
+    s.rebuild(tick, last);
+}
+
+void StateHistory::record(const uint8_t *pins, uint32_t count, uint64_t tick) {
+    if (!budget)
+        return;
+    bool follows = !segments.empty() && count == pinCount && tick > 0 && contains(tick - 1);
+    if (follows && tick - 1 != getLastTick())
+        truncate(tick - 1);
+    packPins(pins, count, current);
+
+    if (!follows) {
+        clear();
+        pinCount = count;
+    }
+    Segment *s = follows ? &segments.back() : nullptr;
+    // New keyframe when the deltas since the last one cost as much to replay as a few keyframes
+    if (!s || s->deltaStart.size() > keyframeInterval || s->words.size() > 4 * s->keyframe.size()) {
+        segments.emplace_back();
+        segments.back().firstTick = tick;
+        segments.back().keyframe = current;
+        bytes += segments.back().memory();
+    } else {
+        size_t before = s->memory();
+        for (uint32_t w = 0; w < current.size(); w++) {
+            uint64_t diff = current[w] ^ last[w];
+            if (diff) {
+                s->words.push_back(w);
+                s->xors.push_back(diff);
+            }
+        }
+        s->deltaStart.push_back((uint32_t) s->words.size());
+        bytes += s->memory() - before;
+    }
+    last.swap(current);
+
+    while (bytes > budget && segments.size() > 1) {
+        bytes -= segments.front().memory();
+        segments.pop_front();
+    }
+}
+
+bool StateHistory::restore(uint64_t tick, uint8_t *pins, uint32_t count) const {
+    const Segment *s = find(tick);
+    if (!s || count != pinCount)
+        return false;
+    std::vector<uint64_t> state;
+    s->rebuild(tick, state);
+    unpackPins(state, pins, count);
+    return true;
+}
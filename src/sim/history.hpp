@@ -0,0 +1,72 @@
+// Recent states for stepping back & scrubbing.
+//
+// States are packed one bit per pin. Segments start with a full keyframe followed by one XOR delta per tick,
+// only the 64 pin words that changed are kept (index + xor). Whole segments are dropped from the oldest end
+// once the memory budget is exceeded, so restoring any recorded tick applies at most one segment of deltas.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+class StateHistory {
+public:
+    // Oldest ticks are forgotten beyond `bytes`, 0 stops recording.
+    void setBudget(size_t bytes);
+
+    size_t getBudget() const { return budget; }
+
+    bool isEnabled() const { return budget != 0; }
+
+    // Longest run of deltas between two keyframes.
+    void setKeyframeInterval(uint32_t ticks) { keyframeInterval = ticks ? ticks : 1; }
+
+    void clear();
+
+    // State after `tick`. Recording from an earlier tick than the last one forgets the ticks after it, recording
+    // something that doesn't follow the history starts it over.
+    void record(const uint8_t *pins, uint32_t count, uint64_t tick);
+
+    bool empty() const { return segments.empty(); }
+
+    uint64_t getFirstTick() const { return segments.empty() ? 0 : segments.front().firstTick; }
+
+    uint64_t getLastTick() const { return segments.empty() ? 0 : segments.back().lastTick(); }
+
+    bool contains(uint64_t tick) const { return !segments.empty() && tick >= getFirstTick() && tick <= getLastTick(); }
+
+    // Write the state after `tick` into `count` pins, false when it is not recorded.
+    bool restore(uint64_t tick, uint8_t *pins, uint32_t count) const;
+
+    size_t getMemoryUsage() const { return bytes; }
+
+private:
+    struct Segment {
+        uint64_t firstTick = 0;
+        std::vector<uint64_t> keyframe;      // state after firstTick
+        std::vector<uint32_t> deltaStart{0}; // delta k gives the state after firstTick + k + 1
+        std::vector<uint32_t> words;
+        std::vector<uint64_t> xors;
+
+        uint64_t lastTick() const { return firstTick + deltaStart.size() - 1; }
+
+        size_t memory() const;
+
+        // Keyframe + deltas up to `tick`.
+        void rebuild(uint64_t tick, std::vector<uint64_t> &state) const;
+    };
+
+    std::deque<Segment> segments;
+    std::vector<uint64_t> last; // state after getLastTick()
+    std::vector<uint64_t> current;
+    uint32_t pinCount = 0;
+    size_t budget = 0;
+    size_t bytes = 0;
+    uint32_t keyframeInterval = 1024;
+
+    const Segment *find(uint64_t tick) const;
+
+    void truncate(uint64_t tick);
+};
@@ -0,0 +1,256 @@
+#include "kernels.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define KERNEL_TARGET(isa)
+#else
+#define KERNEL_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+// ---- Scalar ----
+
+static void scalarNot(uint8_t *p, const uint32_t *in, uint32_t first, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++)
+        p[first + i] = p[in[i]] ^ 1;
+}
+
+static void scalarAnd(uint8_t *p, const uint32_t *in, uint32_t first, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++)
+        p[first + i] = p[in[2 * i]] & p[in[2 * i + 1]];
+}
+
+static void scalarOr(uint8_t *p, const uint32_t *in, uint32_t first, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++)
+        p[first + i] = p[in[2 * i]] | p[in[2 * i + 1]];
+}
+
+static void scalarXor(uint8_t *p, const uint32_t *in, uint32_t first, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++)
+        p[first + i] = p[in[2 * i]] ^ p[in[2 * i + 1]];
+}
+
+static void scalarCopy(uint8_t *p, const uint32_t *src, uint32_t first, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++)
+        p[first + i] = p[src[i]];
+}
+
+static const GateKernels scalarKernels = {"scalar", scalarNot, scalarAnd, scalarOr, scalarXor, scalarCopy};
+
+#if KERNELS_X86
+
+enum class BinaryOp {
+    AND,
+    OR,
+    XOR
+};
+
+// ---- SSE2, benchmark only : no gather instruction, 16 scalar loads feed one vector op and one store ----
+
+template<BinaryOp op>
+static KERNEL_TARGET("sse2") void sse2Binary(uint8_t *p, const uint32_t *in, uint32_t first, uint32_t count) {
+    uint32_t i = 0;
+    alignas(16) uint8_t a[16];
+    alignas(16) uint8_t b[16];
+    for (; i + 16 <= count; i += 16) {
+        const uint32_t *idx = in + 2 * i;
+        for (int k = 0; k < 16; k++) {
+            a[k] = p[idx[2 * k]];
+            b[k] = p[idx[2 * k + 1]];
+        }
+        __m128i va = _mm_load_si128((const __m128i *) a);
+        __m128i vb = _mm_load_si128((const __m128i *) b);
+        __m128i r = op == BinaryOp::AND ? _mm_and_si128(va, vb) : op == BinaryOp::OR ? _mm_or_si128(va, vb)
+                                                                                     : _mm_xor_si128(va, vb);
+        _mm_storeu_si128((__m128i *) (p + first + i), r);
+    }
+    for (; i < count; i++) {
+        uint8_t x = p[in[2 * i]], y = p[in[2 * i + 1]];
+        p[first + i] = op == BinaryOp::AND ? x & y : op == BinaryOp::OR ? x | y : x ^ y;
+    }
+}
+
+// NOT and link copies are the same gather, NOT flips the result.
+template<bool invert>
+static KERNEL_TARGET("sse2") void sse2Unary(uint8_t *p, const uint32_t *in, uint32_t first, uint32_t count) {
+    uint32_t i = 0;
+    alignas(16) uint8_t a[16];
+    const __m128i flip = _mm_set1_epi8(invert ? 1 : 0);
+    for (; i + 16 <= count; i += 16) {
+        for (int k = 0; k < 16; k++)
+            a[k] = p[in[i + k]];
+        __m128i r = _mm_xor_si128(_mm_load_si128((const __m128i *) a), flip);
+        _mm_storeu_si128((__m128i *) (p + first + i), r);
+    }
+    for (; i < count; i++)
+        p[first + i] = p[in[i]] ^ (invert ? 1 : 0);
+}
+
+static const GateKernels sse2Kernels = {"sse2", sse2Unary<true>, sse2Binary<BinaryOp::AND>, sse2Binary<BinaryOp::OR>,
+                                        sse2Binary<BinaryOp::XOR>, sse2Unary<false>};
+
+// ---- AVX2 : 8 pins per 32 bit gather, the low byte of each lane is the pin ----
+
+static inline KERNEL_TARGET("avx2") void avx2Store8(uint8_t *dst, __m256i v) {
+    const __m256i lowBytes = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                              0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    v = _mm256_shuffle_epi8(v, lowBytes);
+    uint64_t out = (uint32_t) _mm_cvtsi128_si32(_mm256_castsi256_si128(v)) |
+                   ((uint64_t) (uint32_t) _mm_cvtsi128_si32(_mm256_extracti128_si256(v, 1)) << 32);
+    std::memcpy(dst, &out, 8);
+}
+
+template<BinaryOp op>
+static KERNEL_TARGET("avx2") void avx2Binary(uint8_t *p, const uint32_t *in, uint32_t first, uint32_t count) {
+    uint32_t i = 0;
+    const __m256i evenOdd = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    for (; i + 8 <= count; i += 8) {
+        // split the 8 interleaved (a, b) pairs into a & b indices
+        __m256i i0 = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *) (in + 2 * i)), evenOdd);
+        __m256i i1 = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *) (in + 2 * i + 8)), evenOdd);
+        __m256i ia = _mm256_permute2x128_si256(i0, i1, 0x20);
+        __m256i ib = _mm256_permute2x128_si256(i0, i1, 0x31);
+        __m256i va = _mm256_i32gather_epi32((const int *) p, ia, 1);
+        __m256i vb = _mm256_i32gather_epi32((const int *) p, ib, 1);
+        __m256i r = op == BinaryOp::AND ? _mm256_and_si256(va, vb) : op == BinaryOp::OR ? _mm256_or_si256(va, vb)
+                                                                                        : _mm256_xor_si256(va, vb);
+        avx2Store8(p + first + i, r);
+    }
+    for (; i < count; i++) {
+        uint8_t x = p[in[2 * i]], y = p[in[2 * i + 1]];
+        p[first + i] = op == BinaryOp::AND ? x & y : op == BinaryOp::OR ? x | y : x ^ y;
+    }
+}
+
+template<bool invert>
+static KERNEL_TARGET("avx2") void avx2Unary(uint8_t *p, const uint32_t *in, uint32_t first, uint32_t count) {
+    uint32_t i = 0;
+    const __m256i flip = _mm256_set1_epi32(invert ? 1 : 0);
+    for (; i + 8 <= count; i += 8) {
+        __m256i idx = _mm256_loadu_si256((const __m256i *) (in + i));
+        __m256i v = _mm256_xor_si256(_mm256_i32gather_epi32((const int *) p, idx, 1), flip);
+        avx2Store8(p + first + i, v);
+    }
+    for (; i < count; i++)
+        p[first + i] = p[in[i]] ^ (invert ? 1 : 0);
+}
+
+static const GateKernels avx2Kernels = {"avx2", avx2Unary<true>, avx2Binary<BinaryOp::AND>, avx2Binary<BinaryOp::OR>,
+                                        avx2Binary<BinaryOp::XOR>, avx2Unary<false>};
+
+// ---- AVX-512 : 16 pins per gather, truncated to bytes by vpmovdb ----
+
+// Masked forms with a zero passthrough, the plain intrinsics leave it undefined
+static inline KERNEL_TARGET("avx512f") __m512i avx512Gather(__m512i idx, const uint8_t *p) {
+    return _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), (__mmask16) 0xFFFF, idx, (const void *) p, 1);
+}
+
+static inline KERNEL_TARGET("avx512f") void avx512Store16(uint8_t *dst, __m512i v) {
+    _mm_storeu_si128((__m128i *) dst, _mm512_maskz_cvtepi32_epi8((__mmask16) 0xFFFF, v));
+}
+
+template<BinaryOp op>
+static KERNEL_TARGET("avx512f") void avx512Binary(uint8_t *p, const uint32_t *in, uint32_t first, uint32_t count) {
+    uint32_t i = 0;
+    const __m512i even = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+    const __m512i odd = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+    const __m512i lowByte = _mm512_set1_epi32(0xFF);
+    for (; i + 16 <= count; i += 16) {
+        __m512i i0 = _mm512_loadu_si512((const void *) (in + 2 * i));
+        __m512i i1 = _mm512_loadu_si512((const void *) (in + 2 * i + 16));
+        __m512i va = avx512Gather(_mm512_permutex2var_epi32(i0, even, i1), p);
+        __m512i vb = avx512Gather(_mm512_permutex2var_epi32(i0, odd, i1), p);
+        __m512i r = op == BinaryOp::AND ? _mm512_and_si512(va, vb) : op == BinaryOp::OR ? _mm512_or_si512(va, vb)
+                                                                                        : _mm512_xor_si512(va, vb);
+        avx512Store16(p + first + i, _mm512_and_si512(r, lowByte));
+    }
+    for (; i < count; i++) {
+        uint8_t x = p[in[2 * i]], y = p[in[2 * i + 1]];
+        p[first + i] = op == BinaryOp::AND ? x & y : op == BinaryOp::OR ? x | y : x ^ y;
+    }
+}
+
+template<bool invert>
+static KERNEL_TARGET("avx512f") void avx512Unary(uint8_t *p, const uint32_t *in, uint32_t first, uint32_t count) {
+    uint32_t i = 0;
+    const __m512i flip = _mm512_set1_epi32(invert ? 1 : 0);
+    const __m512i lowByte = _mm512_set1_epi32(0xFF);
+    for (; i + 16 <= count; i += 16) {
+        __m512i idx = _mm512_loadu_si512((const void *) (in + i));
+        __m512i v = _mm512_xor_si512(avx512Gather(idx, p), flip);
+        avx512Store16(p + first + i, _mm512_and_si512(v, lowByte));
+    }
+    for (; i < count; i++)
+        p[first + i] = p[in[i]] ^ (invert ? 1 : 0);
+}
+
+static const GateKernels avx512Kernels = {"avx512", avx512Unary<true>, avx512Binary<BinaryOp::AND>,
+                                          avx512Binary<BinaryOp::OR>, avx512Binary<BinaryOp::XOR>,
+                                          avx512Unary<false>};
+
+// ---- CPU features ----
+
+struct CpuFeatures {
+    bool sse2 = false;
+    bool avx2 = false;
+    bool avx512 = false;
+};
+
+static CpuFeatures detectCpuFeatures() {
+    CpuFeatures f;
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    f.sse2 = (info[3] >> 26) & 1;
+    bool osxsave = (info[2] >> 27) & 1;
+    if (osxsave && maxLeaf >= 7) {
+        unsigned long long xcr0 = _xgetbv(0);
+        bool ymm = (xcr0 & 0x6) == 0x6;
+        bool zmm = (xcr0 & 0xE6) == 0xE6;
+        __cpuidex(info, 7, 0);
+        f.avx2 = ymm && ((info[1] >> 5) & 1);
+        f.avx512 = zmm && ((info[1] >> 16) & 1);
+    }
+#else
+    __builtin_cpu_init();
+    f.sse2 = __builtin_cpu_supports("sse2");
+    f.avx2 = __builtin_cpu_supports("avx2");
+    f.avx512 = __builtin_cpu_supports("avx512f");
+#endif
+    return f;
+}
+
+#endif
+
+std::vector<const GateKernels *> getSupportedGateKernels() {
+    std::vector<const GateKernels *> kernels = {&scalarKernels};
+#if KERNELS_X86
+    static const CpuFeatures features = detectCpuFeatures();
+    if (features.sse2)
+        kernels.push_back(&sse2Kernels);
+    if (features.avx2)
+        kernels.push_back(&avx2Kernels);
+    if (features.avx512)
+        kernels.push_back(&avx512Kernels);
+#endif
+    return kernels;
+}
+
+const GateKernels &selectGateKernels() {
+    static const GateKernels *best = [] {
+        std::vector<const GateKernels *> kernels = getSupportedGateKernels();
+#if KERNELS_X86
+        // Without a gather instruction SSE2 loses to the scalar loops, it is only there to be benchmarked
+        kernels.erase(std::remove(kernels.begin(), kernels.end(), &sse2Kernels), kernels.end());
+#endif
+        return kernels.back();
+    }();
+    return *best;
+}
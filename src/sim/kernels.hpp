@@ -0,0 +1,33 @@
+// Gate & link kernels for the one byte per pin engine, chosen at runtime from the CPU features.
+//
+// Every kernel handles a range of gates sharing the same operation : gate first + i writes pin first + i
+// and reads its inputs from `in` (one pin per gate for NOT, interleaved pairs for AND/OR/XOR).
+// Pin arrays must be readable PIN_PADDING bytes past their end since gathers load 32 bits at a time.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+constexpr uint32_t PIN_PADDING = 4;
+
+struct GateKernels {
+    const char *name;
+
+    void (*notGates)(uint8_t *pins, const uint32_t *in, uint32_t first, uint32_t count);
+
+    void (*andGates)(uint8_t *pins, const uint32_t *in, uint32_t first, uint32_t count);
+
+    void (*orGates)(uint8_t *pins, const uint32_t *in, uint32_t first, uint32_t count);
+
+    void (*xorGates)(uint8_t *pins, const uint32_t *in, uint32_t first, uint32_t count);
+
+    // pins[first + j] = pins[src[j]]
+    void (*copyLinks)(uint8_t *pins, const uint32_t *src, uint32_t first, uint32_t count);
+};
+
+// Scalar first, then every SIMD kernel set this CPU can run.
+std::vector<const GateKernels *> getSupportedGateKernels();
+
+// The widest kernel set with hardware gathers this CPU can run (AVX2 or AVX-512), scalar otherwise.
+const GateKernels &selectGateKernels();
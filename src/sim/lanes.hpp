@@ -0,0 +1,95 @@
+// Bitsliced words : bit i of every pin belongs to an independent simulation i.
+// A byte holding 0 or 1 is the single lane case used by the editor.
+
+#pragma once
+
+#include <cstdint>
+
+// n * 64 lanes, plain loops the compiler turns into SIMD registers.
+template<int n>
+struct Lanes {
+    uint64_t w[n];
+};
+
+template<int n>
+inline Lanes<n> operator&(const Lanes<n> &a, const Lanes<n> &b) {
+    Lanes<n> r;
+    for (int i = 0; i < n; i++)
+        r.w[i] = a.w[i] & b.w[i];
+    return r;
+}
+
+template<int n>
+inline Lanes<n> operator|(const Lanes<n> &a, const Lanes<n> &b) {
+    Lanes<n> r;
+    for (int i = 0; i < n; i++)
+        r.w[i] = a.w[i] | b.w[i];
+    return r;
+}
+
+template<int n>
+inline Lanes<n> operator^(const Lanes<n> &a, const Lanes<n> &b) {
+    Lanes<n> r;
+    for (int i = 0; i < n; i++)
+        r.w[i] = a.w[i] ^ b.w[i];
+    return r;
+}
+
+template<int n>
+inline bool operator==(const Lanes<n> &a, const Lanes<n> &b) {
+    for (int i = 0; i < n; i++)
+        if (a.w[i] != b.w[i])
+            return false;
+    return true;
+}
+
+template<int n>
+inline bool operator!=(const Lanes<n> &a, const Lanes<n> &b) {
+    return !(a == b);
+}
+
+using Lanes256 = Lanes<4>;
+using Lanes512 = Lanes<8>;
+
+template<typename Word>
+struct LaneTraits;
+
+template<>
+struct LaneTraits<uint8_t> {
+    static constexpr int count = 1;
+
+    static uint8_t fill(bool value) { return value; }
+
+    static bool get(uint8_t w, int) { return w; }
+
+    static void set(uint8_t &w, int, bool value) { w = value; }
+};
+
+template<>
+struct LaneTraits<uint64_t> {
+    static constexpr int count = 64;
+
+    static uint64_t fill(bool value) { return value ? ~0ull : 0ull; }
+
+    static bool get(uint64_t w, int lane) { return (w >> lane) & 1; }
+
+    static void set(uint64_t &w, int lane, bool value) {
+        w = (w & ~(1ull << lane)) | ((uint64_t) value << lane);
+    }
+};
+
+template<int n>
+struct LaneTraits<Lanes<n>> {
+    static constexpr int count = 64 * n;
+
+    static Lanes<n> fill(bool value) {
+        Lanes<n> r;
+        for (int i = 0; i < n; i++)
+            r.w[i] = LaneTraits<uint64_t>::fill(value);
+        return r;
+    }
+
+    static bool get(const Lanes<n> &w, int lane) { return LaneTraits<uint64_t>::get(w.w[lane / 64], lane % 64); }
+
+    static void set(Lanes<n> &w, int lane, bool value) { LaneTraits<uint64_t>::set(w.w[lane / 64], lane % 64, value); }
+};
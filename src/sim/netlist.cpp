@@ -0,0 +1,408 @@
+#include "netlist.hpp"
+#include "partitioner.hpp"
+#include "node/composite.hpp"
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+
+// Fill opStart & linkPartStart for a single partition.
+static void setSinglePartition(Netlist &net) {
+    net.partitionCount = 1;
+    net.opStart.assign(Netlist::OP_COUNT + 1, 0);
+    for (uint32_t op = 0; op <= Netlist::OP_COUNT; op++)
+        net.opStart[op] = (uint32_t) (std::lower_bound(net.ops.begin(), net.ops.end(), (NodeOp) op) - net.ops.begin());
+    net.linkPartStart = {0, net.getLinkCount()};
+    net.cutLinks = 0;
+}
+
+namespace {
+
+constexpr uint32_t PORT = 0x80000000u; // PORT | i : input port i of a body, resolved when the body is stamped
+constexpr uint32_t NONE = UINT32_MAX;
+
+// A circuit over "flat pins", numbered in slot order (see node/composite.hpp). A definition is built once per
+// compile, then stamped with an offset for each instance.
+struct Level {
+    uint32_t pinCount = 0;
+    std::vector<NodeOp> ops;           // per gate
+    std::vector<uint32_t> gateOutputs; // per gate
+    std::vector<uint32_t> inputStart{0};
+    std::vector<uint32_t> inputPins;
+    std::vector<uint32_t> sources;     // other outputs
+    std::vector<uint32_t> inputs;      // every input
+    std::vector<uint32_t> linkSrc;     // resolved through the ports of inner instances
+    std::vector<uint32_t> linkDst;
+    std::vector<uint32_t> outputRefs;  // per output port, what a link reading it reads
+    std::vector<uint32_t> outputShown; // per output port, the input of the OUT node
+
+    // Top level only
+    std::vector<Connector *> connectors; // per pin, nullptr inside instances
+    std::unordered_map<const Connector *, uint32_t> pinOf;
+    std::vector<std::pair<CompositeNode *, uint32_t>> instances; // first slot pin
+    std::vector<std::pair<Connector *, uint32_t>> aliases;
+};
+
+class Flattener {
+public:
+    void build(const Circuit &circuit, bool body, Level &level) {
+        std::vector<uint32_t> wires; // instance inputs
+        uint32_t inputPort = 0;
+        auto newPin = [&](Connector *c) {
+            if (!body)
+                level.connectors.push_back(c);
+            return level.pinOf[c] = level.pinCount++;
+        };
+
+        for (Node *node: circuit.getNodes()) {
+            NodeOp op = node->getOp();
+            if (body && op == NodeOp::INPUT) {
+                level.pinOf[node->outputs[0]] = PORT | inputPort++;
+            } else if (body && op == NodeOp::OUTPUT) {
+                uint32_t pin = newPin(node->inputs[0]);
+                level.inputs.push_back(pin);
+                level.outputShown.push_back(pin);
+            } else if (op == NodeOp::COMPOSITE) {
+                auto composite = static_cast<CompositeNode *>(node);
+                std::vector<uint32_t> ports;
+                for (Connector *c: node->inputs) {
+                    ports.push_back(newPin(c));
+                    level.inputs.push_back(ports.back());
+                    wires.push_back(ports.back());
+                }
+                const Level &definition = stampOf(*composite->getDefinition());
+                uint32_t base = level.pinCount;
+                std::vector<uint32_t> outputs = stamp(definition, ports, level);
+                for (size_t j = 0; j < node->outputs.size(); j++)
+                    level.pinOf[node->outputs[j]] = outputs[j];
+                if (!body) {
+                    level.connectors.resize(level.pinCount, nullptr);
+                    level.instances.emplace_back(composite, base);
+                    for (size_t j = 0; j < node->outputs.size(); j++)
+                        level.aliases.emplace_back(node->outputs[j], base + definition.outputShown[j]);
+                }
+            } else {
+                for (Connector *c: node->inputs)
+                    level.inputs.push_back(newPin(c));
+                bool gate = isGateOp(op);
+                for (Connector *c: node->outputs) {
+                    uint32_t pin = newPin(c);
+                    if (!gate) {
+                        level.sources.push_back(pin);
+                        continue;
+                    }
+                    gate = false;
+                    level.ops.push_back(op);
+                    level.gateOutputs.push_back(pin);
+                    for (Connector *in: node->inputs)
+                        level.inputPins.push_back(level.pinOf[in]);
+                    level.inputStart.push_back((uint32_t) level.inputPins.size());
+                }
+            }
+        }
+        for (const Link *link: circuit.getLinks()) {
+            level.linkSrc.push_back(level.pinOf.at(link->input));
+            level.linkDst.push_back(level.pinOf.at(link->output));
+        }
+
+        // Instance inputs are wires : a link reading one reads the last link reaching it, unless nothing does.
+        // A loop made of wires only stops on an instance input.
+        std::unordered_map<uint32_t, uint32_t> driver;
+        for (uint32_t pin: wires)
+            driver[pin] = NONE;
+        for (uint32_t pin: level.outputShown)
+            driver[pin] = NONE;
+        if (driver.empty())
+            return;
+        for (uint32_t j = 0; j < level.linkDst.size(); j++) {
+            auto d = driver.find(level.linkDst[j]);
+            if (d != driver.end())
+                d->second = j;
+        }
+        std::vector<uint32_t> raw = level.linkSrc;
+        for (uint32_t &src: level.linkSrc) {
+            for (size_t hops = 0; !(src & PORT) && hops <= wires.size(); hops++) {
+                auto d = driver.find(src);
+                if (d == driver.end() || d->second == NONE)
+                    break;
+                src = raw[d->second];
+            }
+        }
+        for (uint32_t pin: level.outputShown) {
+            uint32_t j = driver[pin];
+            level.outputRefs.push_back(j == NONE ? pin : level.linkSrc[j]);
+        }
+    }
+
+private:
+    std::unordered_map<const CircuitDefinition *, Level> stamps;
+
+    const Level &stampOf(const CircuitDefinition &definition) {
+        auto it = stamps.find(&definition);
+        if (it != stamps.end())
+            return it->second;
+        Level level;
+        build(definition.body, true, level);
+        level.pinOf.clear();
+        return stamps.emplace(&definition, std::move(level)).first->second;
+    }
+
+    // Append `stamp` to `level`, its input ports read `ports`. Returns what its output ports read.
+    std::vector<uint32_t> stamp(const Level &stamp, const std::vector<uint32_t> &ports, Level &level) {
+        const uint32_t base = level.pinCount;
+        auto place = [&](uint32_t ref) { return ref & PORT ? ports[ref & ~PORT] : base + ref; };
+        level.pinCount += stamp.pinCount;
+        for (size_t g = 0; g < stamp.ops.size(); g++) {
+            level.ops.push_back(stamp.ops[g]);
+            level.gateOutputs.push_back(base + stamp.gateOutputs[g]);
+            for (uint32_t k = stamp.inputStart[g]; k < stamp.inputStart[g + 1]; k++)
+                level.inputPins.push_back(base + stamp.inputPins[k]);
+            level.inputStart.push_back((uint32_t) level.inputPins.size());
+        }
+        for (uint32_t pin: stamp.sources)
+            level.sources.push_back(base + pin);
+        for (uint32_t pin: stamp.inputs)
+            level.inputs.push_back(base + pin);
+        for (size_t j = 0; j < stamp.linkSrc.size(); j++) {
+            level.linkSrc.push_back(place(stamp.linkSrc[j]));
+            level.linkDst.push_back(base + stamp.linkDst[j]);
+        }
+        std::vector<uint32_t> outputs;
+        for (uint32_t ref: stamp.outputRefs)
+            outputs.push_back(place(ref));
+        return outputs;
+    }
+};
+
+}
+
+Netlist Netlist::compile(const Circuit &circuit) {
+    Netlist net;
+    Level flat;
+    Flattener().build(circuit, false, flat);
+    std::vector<uint32_t> pinOf(flat.pinCount, NONE);
+
+    auto addPin = [&](uint32_t p) {
+        pinOf[p] = (uint32_t) net.connectors.size();
+        net.connectors.push_back(flat.connectors[p]);
+    };
+
+    // ---- Gate outputs, grouped by operation ----
+    std::vector<uint32_t> gates(flat.ops.size());
+    std::iota(gates.begin(), gates.end(), 0);
+    std::stable_sort(gates.begin(), gates.end(), [&](uint32_t a, uint32_t b) {
+        return flat.ops[a] < flat.ops[b];
+    });
+    for (uint32_t g: gates) {
+        addPin(flat.gateOutputs[g]);
+        net.ops.push_back(flat.ops[g]);
+    }
+    net.gateCount = (uint32_t) gates.size();
+
+    // ---- Sources : every other output ----
+    for (uint32_t p: flat.sources)
+        addPin(p);
+    net.linkBase = (uint32_t) net.connectors.size();
+
+    // ---- Linked inputs : the last link reaching an input drives it, like Link::propagate() order ----
+    const uint32_t linkCount = (uint32_t) flat.linkSrc.size();
+    std::vector<uint32_t> driver(flat.pinCount, NONE);
+    for (uint32_t j = 0; j < linkCount; j++)
+        driver[flat.linkDst[j]] = j;
+    for (uint32_t j = 0; j < linkCount; j++) {
+        if (driver[flat.linkDst[j]] != j)
+            continue;
+        addPin(flat.linkDst[j]);
+        net.linkSrc.push_back(flat.linkSrc[j]);
+    }
+    net.floatingBase = (uint32_t) net.connectors.size();
+
+    // ---- Unconnected inputs ----
+    for (uint32_t p: flat.inputs)
+        if (pinOf[p] == NONE)
+            addPin(p);
+    net.pinCount = (uint32_t) net.connectors.size();
+
+    for (uint32_t &src: net.linkSrc)
+        src = pinOf[src];
+    for (const auto &alias: flat.aliases)
+        net.aliases.emplace_back(alias.first, pinOf[alias.second]);
+
+    // ---- Circuit inputs & outputs ----
+    for (Node *node: circuit.getNodes()) {
+        if (node->getOp() == NodeOp::INPUT)
+            for (Connector *c: node->outputs)
+                net.circuitInputs.push_back(pinOf[flat.pinOf.at(c)]);
+        else if (node->getOp() == NodeOp::OUTPUT)
+            for (Connector *c: node->inputs)
+                net.circuitOutputs.push_back(pinOf[flat.pinOf.at(c)]);
+    }
+
+    // ---- Gate inputs ----
+    net.inputStart.reserve(gates.size() + 1);
+    net.inputStart.push_back(0);
+    for (uint32_t g: gates) {
+        for (uint32_t k = flat.inputStart[g]; k < flat.inputStart[g + 1]; k++)
+            net.inputPins.push_back(pinOf[flat.inputPins[k]]);
+        net.inputStart.push_back((uint32_t) net.inputPins.size());
+    }
+
+    // ---- Link objects : the links of the circuit itself, after the ones of instance bodies ----
+    const std::vector<Link *> &links = circuit.getLinks();
+    const uint32_t first = linkCount - (uint32_t) links.size();
+    net.linkObjects = links;
+    net.linkObjectPins.reserve(links.size() * 2);
+    for (uint32_t j = first; j < linkCount; j++) {
+        net.linkObjectPins.push_back(pinOf[flat.linkSrc[j]]);
+        net.linkObjectPins.push_back(pinOf[flat.linkDst[j]]);
+    }
+
+    // ---- Instance slots ----
+    net.instanceStart.push_back(0);
+    for (const auto &instance: flat.instances) {
+        net.instances.push_back(instance.first);
+        for (uint32_t s = 0; s < instance.first->states.size(); s++)
+            net.instancePins.push_back(pinOf[instance.second + s]);
+        net.instanceStart.push_back((uint32_t) net.instancePins.size());
+    }
+    setSinglePartition(net);
+    return net;
+}
+
+std::vector<uint64_t> Netlist::getPinIds() const {
+    std::vector<uint64_t> ids(pinCount);
+    for (uint32_t pin = 0; pin < pinCount; pin++)
+        if (connectors[pin])
+            ids[pin] = connectors[pin]->id;
+    for (size_t i = 0; i < instances.size(); i++)
+        for (uint32_t k = instanceStart[i]; k < instanceStart[i + 1]; k++)
+            ids[instancePins[k]] = instances[i]->getStateId() + (k - instanceStart[i]);
+    return ids;
+}
+
+std::vector<uint32_t> Netlist::partition(uint32_t parts) {
+    parts = std::max(parts, 1u);
+    std::vector<uint32_t> gatePart(gateCount, 0);
+    if (parts > 1)
+        gatePart = partitionGates(*this, parts);
+
+    // A link belongs to the partition of the gate reading it, or of the gate it reads when it feeds an OUT node
+    std::vector<uint32_t> readerStart, readers;
+    buildGateFanout(readerStart, readers);
+    const uint32_t linkCount = getLinkCount();
+    std::vector<uint32_t> linkPart(linkCount, 0), linkReader(linkCount, UINT32_MAX);
+    for (uint32_t j = 0; j < linkCount; j++) {
+        uint32_t pin = linkBase + j;
+        if (readerStart[pin] != readerStart[pin + 1]) {
+            linkReader[j] = readers[readerStart[pin]];
+            linkPart[j] = gatePart[linkReader[j]];
+        } else if (linkSrc[j] < gateCount)
+            linkPart[j] = gatePart[linkSrc[j]];
+    }
+
+    // ---- New orders : gates by (partition, op), links by (partition, reader) ----
+    std::vector<uint32_t> gateOrder(gateCount), linkOrder(linkCount);
+    std::iota(gateOrder.begin(), gateOrder.end(), 0);
+    std::stable_sort(gateOrder.begin(), gateOrder.end(), [&](uint32_t a, uint32_t b) {
+        return gatePart[a] != gatePart[b] ? gatePart[a] < gatePart[b] : ops[a] < ops[b];
+    });
+    std::vector<uint32_t> pinMap(pinCount);
+    std::iota(pinMap.begin(), pinMap.end(), 0);
+    for (uint32_t g = 0; g < gateCount; g++)
+        pinMap[gateOrder[g]] = g;
+    std::iota(linkOrder.begin(), linkOrder.end(), 0);
+    auto readerRank = [&](uint32_t j) { return linkReader[j] == UINT32_MAX ? UINT32_MAX : pinMap[linkReader[j]]; };
+    std::stable_sort(linkOrder.begin(), linkOrder.end(), [&](uint32_t a, uint32_t b) {
+        return linkPart[a] != linkPart[b] ? linkPart[a] < linkPart[b] : readerRank(a) < readerRank(b);
+    });
+    for (uint32_t j = 0; j < linkCount; j++)
+        pinMap[linkBase + linkOrder[j]] = linkBase + j;
+
+    // ---- Apply ----
+    std::vector<NodeOp> newOps(gateCount);
+    std::vector<uint32_t> newInputStart(1, 0), newInputPins;
+    newInputStart.reserve(gateCount + 1);
+    newInputPins.reserve(inputPins.size());
+    for (uint32_t g = 0; g < gateCount; g++) {
+        uint32_t old = gateOrder[g];
+        newOps[g] = ops[old];
+        for (uint32_t k = inputStart[old]; k < inputStart[old + 1]; k++)
+            newInputPins.push_back(pinMap[inputPins[k]]);
+        newInputStart.push_back((uint32_t) newInputPins.size());
+    }
+    ops = std::move(newOps);
+    inputStart = std::move(newInputStart);
+    inputPins = std::move(newInputPins);
+
+    std::vector<uint32_t> newLinkSrc(linkCount);
+    for (uint32_t j = 0; j < linkCount; j++)
+        newLinkSrc[j] = pinMap[linkSrc[linkOrder[j]]];
+    linkSrc = std::move(newLinkSrc);
+
+    for (uint32_t &pin: circuitInputs)
+        pin = pinMap[pin];
+    for (uint32_t &pin: circuitOutputs)
+        pin = pinMap[pin];
+    for (uint32_t &pin: linkObjectPins)
+        pin = pinMap[pin];
+    for (auto &alias: aliases)
+        alias.second = pinMap[alias.second];
+    for (uint32_t &pin: instancePins)
+        pin = pinMap[pin];
+    for (uint32_t &pin: sweptPins)
+        pin = pinMap[pin];
+    std::vector<Connector *> newConnectors(pinCount);
+    for (uint32_t pin = 0; pin < pinCount; pin++)
+        newConnectors[pinMap[pin]] = connectors[pin];
+    connectors = std::move(newConnectors);
+
+    // ---- Ranges ----
+    partitionCount = parts;
+    opStart.assign(parts * OP_COUNT + 1, 0);
+    std::vector<uint32_t> counts(parts * OP_COUNT, 0);
+    for (uint32_t g = 0; g < gateCount; g++)
+        counts[gatePart[gateOrder[g]] * OP_COUNT + (uint32_t) ops[g]]++;
+    for (uint32_t i = 0; i < parts * OP_COUNT; i++)
+        opStart[i + 1] = opStart[i] + counts[i];
+    linkPartStart.assign(parts + 1, 0);
+    for (uint32_t j = 0; j < linkCount; j++)
+        linkPartStart[linkPart[j] + 1]++;
+    for (uint32_t k = 0; k < parts; k++)
+        linkPartStart[k + 1] += linkPartStart[k];
+
+    cutLinks = 0;
+    for (uint32_t j = 0; j < linkCount; j++) {
+        uint32_t old = linkOrder[j];
+        cutLinks += linkSrc[j] < gateCount && gatePart[gateOrder[linkSrc[j]]] != linkPart[old];
+    }
+    return pinMap;
+}
+
+void buildCsr(uint32_t keyCount, const std::vector<std::pair<uint32_t, uint32_t>> &pairs,
+              std::vector<uint32_t> &start, std::vector<uint32_t> &values) {
+    start.assign(keyCount + 1, 0);
+    for (const auto &p: pairs)
+        start[p.first + 1]++;
+    for (uint32_t i = 0; i < keyCount; i++)
+        start[i + 1] += start[i];
+    values.resize(pairs.size());
+    std::vector<uint32_t> fill(start.begin(), start.end() - 1);
+    for (const auto &p: pairs)
+        values[fill[p.first]++] = p.second;
+}
+
+void Netlist::buildLinkFanout(std::vector<uint32_t> &start, std::vector<uint32_t> &links) const {
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    pairs.reserve(linkSrc.size());
+    for (uint32_t j = 0; j < linkSrc.size(); j++)
+        pairs.emplace_back(linkSrc[j], j);
+    buildCsr(pinCount, pairs, start, links);
+}
+
+void Netlist::buildGateFanout(std::vector<uint32_t> &start, std::vector<uint32_t> &gates) const {
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    pairs.reserve(inputPins.size());
+    for (uint32_t g = 0; g < gateCount; g++)
+        for (uint32_t k = inputStart[g]; k < inputStart[g + 1]; k++)
+            pairs.emplace_back(inputPins[k], g);
+    buildCsr(pinCount, pairs, start, gates);
+}
@@ -0,0 +1,88 @@
+// Flat, structure-of-arrays form of a circuit.
+//
+// Every connector becomes a "pin" holding one bit of state. Gates read input pins and write exactly one
+// output pin, links copy an output pin into an input pin. Pins are laid out so most accesses are contiguous :
+//
+//   [0, gateCount)               gate outputs, gate g writes pin g
+//   [gateCount, linkBase)        source outputs (nodes that never update, like TRUE)
+//   [linkBase, floatingBase)     linked inputs, link j writes pin linkBase + j
+//   [floatingBase, pinCount)     unconnected inputs, they keep their value
+//
+// Gates are grouped by partition (see partition()) then sorted by operation, so each operation of a partition
+// covers a single range of gates. Links are grouped by the partition reading them.
+
+#pragma once
+
+#include "node/circuit.hpp"
+#include <cstdint>
+#include <vector>
+
+class CompositeNode;
+
+struct Netlist {
+    static constexpr uint32_t OP_COUNT = (uint32_t) NodeOp::COUNT;
+
+    // Gates
+    std::vector<NodeOp> ops;
+    std::vector<uint32_t> inputStart; // CSR offsets into inputPins, gateCount + 1 entries
+    std::vector<uint32_t> inputPins;
+
+    // Partitions : gates [opStart[k * OP_COUNT + op], opStart[k * OP_COUNT + op + 1]) of partition k share `op`,
+    // links [linkPartStart[k], linkPartStart[k + 1]) (link indices) feed partition k.
+    uint32_t partitionCount = 1;
+    std::vector<uint32_t> opStart;
+    std::vector<uint32_t> linkPartStart;
+    uint32_t cutLinks = 0; // links reading a gate of another partition
+
+    // Links
+    std::vector<uint32_t> linkSrc; // pin copied into linkBase + j
+
+    // IN node outputs & OUT node inputs, in node order
+    std::vector<uint32_t> circuitInputs;
+    std::vector<uint32_t> circuitOutputs;
+
+    uint32_t gateCount = 0;
+    uint32_t linkBase = 0;
+    uint32_t floatingBase = 0;
+    uint32_t pinCount = 0;
+
+    // Set by optimizeNetlist() (see sim/optimizer.hpp)
+    bool zeroDelay = false;          // only exact with zero delay links
+    std::vector<uint32_t> sweptPins; // pins the dead sweep stopped computing
+
+    // Authoring model mapping, only used to load/store states.
+    std::vector<Connector *> connectors;   // per pin, nullptr for the slots of an instance
+    std::vector<Link *> linkObjects;       // every link of the circuit, not of instance bodies
+    std::vector<uint32_t> linkObjectPins;  // (src, dst) pins for each linkObjects entry
+    std::vector<std::pair<Connector *, uint32_t>> aliases; // composite port outputs, showing the value of a pin
+    std::vector<CompositeNode *> instances;
+    std::vector<uint32_t> instanceStart;   // CSR offsets into instancePins, instances.size() + 1 entries
+    std::vector<uint32_t> instancePins;    // pin of every slot (see node/composite.hpp)
+
+    uint32_t getLinkCount() const { return floatingBase - linkBase; }
+
+    uint32_t opBegin(uint32_t part, NodeOp op) const { return opStart[part * OP_COUNT + (uint32_t) op]; }
+
+    uint32_t opEnd(uint32_t part, NodeOp op) const { return opStart[part * OP_COUNT + (uint32_t) op + 1]; }
+
+    // Composite nodes are flattened into their primitives : each definition is compiled once, then copied with
+    // an offset for every instance (see node/composite.hpp).
+    static Netlist compile(const Circuit &circuit);
+
+    // Connector id per pin, slots of an instance use the ids it reserved.
+    std::vector<uint64_t> getPinIds() const;
+
+    // Split gates into `parts` balanced regions with few links between them (see sim/partitioner.hpp) and
+    // reorder gates & links so each region is contiguous. Returns the new index of every old pin.
+    std::vector<uint32_t> partition(uint32_t parts);
+
+    // pin -> links copying it (CSR over every pin)
+    void buildLinkFanout(std::vector<uint32_t> &start, std::vector<uint32_t> &links) const;
+
+    // pin -> gates reading it (CSR over every pin)
+    void buildGateFanout(std::vector<uint32_t> &start, std::vector<uint32_t> &gates) const;
+};
+
+// Build a CSR table from (key, value) pairs, keys in [0, keyCount).
+void buildCsr(uint32_t keyCount, const std::vector<std::pair<uint32_t, uint32_t>> &pairs,
+              std::vector<uint32_t> &start, std::vector<uint32_t> &values);
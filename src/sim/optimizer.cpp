@@ -0,0 +1,343 @@
+#include "optimizer.hpp"
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <unordered_map>
+
+namespace {
+
+constexpr int8_t UNKNOWN = -1;
+
+// Removal marks over the compiled netlist, applied at once by rebuild()
+struct Pass {
+    Netlist &net;
+    std::vector<uint8_t> &state;
+    std::vector<uint8_t> keepGate;
+    std::vector<uint8_t> keepLink;
+    std::vector<uint32_t> alias;  // per pin, the pin holding its value (itself when kept)
+    std::vector<int8_t> constant; // per pin, UNKNOWN or the value it keeps
+    std::vector<uint8_t> swept;
+
+    Pass(Netlist &net, std::vector<uint8_t> &state)
+        : net(net), state(state), keepGate(net.gateCount, 1), keepLink(net.getLinkCount(), 1),
+          alias(net.pinCount), constant(net.pinCount, UNKNOWN), swept(net.pinCount, 0) {
+        std::iota(alias.begin(), alias.end(), 0);
+    }
+
+    uint32_t find(uint32_t pin) {
+        while (alias[pin] != pin)
+            pin = alias[pin] = alias[alias[pin]];
+        return pin;
+    }
+
+    bool isLinked(uint32_t pin) const {
+        return pin >= net.linkBase && pin < net.floatingBase && keepLink[pin - net.linkBase];
+    }
+
+    // Pin whose value `pin` copies, itself when nothing writes it
+    uint32_t sourceOf(uint32_t pin) {
+        return isLinked(pin) ? find(net.linkSrc[pin - net.linkBase]) : find(pin);
+    }
+
+    void propagateConstants(OptimizeReport &report);
+    void foldNotPairs(OptimizeReport &report);
+    void mergeGates(OptimizeReport &report);
+    void sweep(OptimizeReport &report, const std::vector<const Connector *> &observed);
+    void rebuild();
+};
+
+// Output forced by the constant inputs of gate g, or UNKNOWN
+int8_t forcedOutput(const Netlist &net, const std::vector<int8_t> &constant, uint32_t g) {
+    const NodeOp op = net.ops[g];
+    bool known = true, value = op == NodeOp::AND;
+    for (uint32_t k = net.inputStart[g]; k < net.inputStart[g + 1]; k++) {
+        int8_t in = constant[net.inputPins[k]];
+        if (in == UNKNOWN) {
+            known = false;
+            continue;
+        }
+        if (op == NodeOp::AND && !in)
+            return 0;
+        if (op == NodeOp::OR && in)
+            return 1;
+        if (op == NodeOp::NOT || op == NodeOp::XOR)
+            value ^= (bool) in;
+    }
+    if (!known)
+        return UNKNOWN;
+    return (int8_t) (op == NodeOp::NOT ? !value : value);
+}
+
+void Pass::propagateConstants(OptimizeReport &report) {
+    std::vector<uint32_t> work;
+    std::vector<uint8_t> isInput(net.pinCount, 0);
+    for (uint32_t pin: net.circuitInputs)
+        isInput[pin] = 1;
+    for (uint32_t pin = net.gateCount; pin < net.linkBase; pin++)
+        if (!isInput[pin]) {
+            constant[pin] = (int8_t) state[pin];
+            work.push_back(pin);
+        }
+    for (uint32_t pin = net.floatingBase; pin < net.pinCount; pin++) {
+        constant[pin] = (int8_t) state[pin];
+        work.push_back(pin);
+    }
+
+    // A pin reading constants only keeps its value once it shows it, the next tick computes the same
+    std::vector<uint32_t> linkStart, links, gateStart, gates;
+    net.buildLinkFanout(linkStart, links);
+    net.buildGateFanout(gateStart, gates);
+    while (!work.empty()) {
+        uint32_t pin = work.back();
+        work.pop_back();
+        for (uint32_t i = linkStart[pin]; i < linkStart[pin + 1]; i++) {
+            uint32_t dst = net.linkBase + links[i];
+            if (constant[dst] == UNKNOWN && state[dst] == (uint8_t) constant[pin]) {
+                constant[dst] = constant[pin];
+                work.push_back(dst);
+            }
+        }
+        for (uint32_t i = gateStart[pin]; i < gateStart[pin + 1]; i++) {
+            uint32_t g = gates[i];
+            if (constant[g] != UNKNOWN)
+                continue;
+            int8_t value = forcedOutput(net, constant, g);
+            if (value != UNKNOWN && state[g] == (uint8_t) value) {
+                constant[g] = value;
+                work.push_back(g);
+            }
+        }
+    }
+
+    for (uint32_t g = 0; g < net.gateCount; g++)
+        if (constant[g] != UNKNOWN) {
+            keepGate[g] = 0;
+            report.constantGates++;
+        }
+    for (uint32_t j = 0; j < net.getLinkCount(); j++)
+        if (constant[net.linkBase + j] != UNKNOWN) {
+            keepLink[j] = 0;
+            report.removedLinks++;
+        }
+}
+
+void Pass::foldNotPairs(OptimizeReport &report) {
+    for (uint32_t b = 0; b < net.gateCount; b++) {
+        if (net.ops[b] != NodeOp::NOT || !keepGate[b] || alias[b] != b)
+            continue;
+        uint32_t a = sourceOf(net.inputPins[net.inputStart[b]]);
+        if (a >= net.gateCount || net.ops[a] != NodeOp::NOT || !keepGate[a])
+            continue;
+        uint32_t x = sourceOf(net.inputPins[net.inputStart[a]]);
+        if (x == b)
+            continue;
+        alias[b] = x;
+        keepGate[b] = 0;
+        report.notPairs++;
+    }
+}
+
+void Pass::mergeGates(OptimizeReport &report) {
+    // Key : op, output state, then the sorted (source, state) of every input. A constant input reads its value.
+    auto inputsOf = [&](uint32_t g) {
+        std::vector<std::pair<uint64_t, uint32_t>> inputs; // (source << 1 | state, pin)
+        for (uint32_t k = net.inputStart[g]; k < net.inputStart[g + 1]; k++) {
+            uint32_t pin = net.inputPins[k];
+            uint64_t source = constant[pin] != UNKNOWN ? UINT32_MAX : isLinked(pin) ? sourceOf(pin) : pin;
+            inputs.emplace_back(source << 1 | state[pin], pin);
+        }
+        std::sort(inputs.begin(), inputs.end());
+        return inputs;
+    };
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        std::map<std::vector<uint64_t>, uint32_t> seen;
+        for (uint32_t g = 0; g < net.gateCount; g++) {
+            if (!keepGate[g])
+                continue;
+            auto inputs = inputsOf(g);
+            std::vector<uint64_t> key{(uint64_t) net.ops[g], state[g]};
+            for (const auto &input: inputs)
+                key.push_back(input.first);
+            auto it = seen.emplace(std::move(key), g);
+            if (it.second)
+                continue;
+
+            uint32_t h = it.first->second;
+            auto kept = inputsOf(h);
+            for (size_t i = 0; i < inputs.size(); i++) {
+                uint32_t pin = inputs[i].second;
+                alias[pin] = kept[i].second;
+                if (isLinked(pin)) {
+                    keepLink[pin - net.linkBase] = 0;
+                    report.removedLinks++;
+                }
+            }
+            alias[g] = h;
+            keepGate[g] = 0;
+            report.mergedGates++;
+            changed = true;
+        }
+    }
+}
+
+void Pass::sweep(OptimizeReport &report, const std::vector<const Connector *> &observed) {
+    std::vector<uint8_t> live(net.pinCount, 0);
+    std::vector<uint32_t> work;
+    auto mark = [&](uint32_t pin) {
+        pin = find(pin);
+        if (!live[pin]) {
+            live[pin] = 1;
+            work.push_back(pin);
+        }
+    };
+    for (uint32_t pin: net.circuitOutputs)
+        mark(pin);
+    std::unordered_map<const Connector *, uint32_t> pinOf;
+    for (uint32_t pin = 0; pin < net.pinCount; pin++)
+        if (net.connectors[pin])
+            pinOf[net.connectors[pin]] = pin;
+    for (const auto &a: net.aliases)
+        pinOf[a.first] = a.second;
+    for (const Connector *c: observed) {
+        auto it = pinOf.find(c);
+        if (it != pinOf.end())
+            mark(it->second);
+    }
+
+    while (!work.empty()) {
+        uint32_t pin = work.back();
+        work.pop_back();
+        if (pin < net.gateCount && keepGate[pin]) {
+            for (uint32_t k = net.inputStart[pin]; k < net.inputStart[pin + 1]; k++)
+                mark(net.inputPins[k]);
+        } else if (isLinked(pin))
+            mark(net.linkSrc[pin - net.linkBase]);
+    }
+
+    for (uint32_t g = 0; g < net.gateCount; g++)
+        if (keepGate[g] && !live[g]) {
+            keepGate[g] = 0;
+            swept[g] = 1;
+            report.deadGates++;
+        }
+    for (uint32_t j = 0; j < net.getLinkCount(); j++)
+        if (keepLink[j] && !live[net.linkBase + j]) {
+            keepLink[j] = 0;
+            swept[net.linkBase + j] = 1;
+            report.removedLinks++;
+        }
+}
+
+// New layout : kept gates, sources (old ones then removed gates), kept links, floating (old ones then pins
+// whose link was removed). Aliased pins are dropped, their connectors show the pin holding their value.
+void Pass::rebuild() {
+    const uint32_t linkCount = net.getLinkCount();
+    std::vector<uint32_t> pinMap(net.pinCount, UINT32_MAX);
+    uint32_t next = 0;
+    auto place = [&](uint32_t pin) {
+        if (alias[pin] == pin)
+            pinMap[pin] = next++;
+    };
+    for (uint32_t g = 0; g < net.gateCount; g++)
+        if (keepGate[g])
+            place(g);
+    const uint32_t gateCount = next;
+    for (uint32_t pin = net.gateCount; pin < net.linkBase; pin++)
+        place(pin);
+    for (uint32_t g = 0; g < net.gateCount; g++)
+        if (!keepGate[g])
+            place(g);
+    const uint32_t linkBase = next;
+    std::vector<uint32_t> keptLinks;
+    for (uint32_t j = 0; j < linkCount; j++)
+        if (keepLink[j]) {
+            place(net.linkBase + j);
+            keptLinks.push_back(j);
+        }
+    const uint32_t floatingBase = next;
+    for (uint32_t pin = net.floatingBase; pin < net.pinCount; pin++)
+        place(pin);
+    for (uint32_t j = 0; j < linkCount; j++)
+        if (!keepLink[j])
+            place(net.linkBase + j);
+    const uint32_t pinCount = next;
+    for (uint32_t pin = 0; pin < net.pinCount; pin++)
+        pinMap[pin] = pinMap[find(pin)];
+
+    std::vector<NodeOp> ops;
+    std::vector<uint32_t> inputStart(1, 0), inputPins;
+    for (uint32_t g = 0; g < net.gateCount; g++) {
+        if (!keepGate[g])
+            continue;
+        ops.push_back(net.ops[g]);
+        for (uint32_t k = net.inputStart[g]; k < net.inputStart[g + 1]; k++)
+            inputPins.push_back(pinMap[net.inputPins[k]]);
+        inputStart.push_back((uint32_t) inputPins.size());
+    }
+    std::vector<uint32_t> linkSrc;
+    for (uint32_t j: keptLinks)
+        linkSrc.push_back(pinMap[net.linkSrc[j]]);
+
+    std::vector<Connector *> connectors(pinCount, nullptr);
+    std::vector<uint8_t> newState(pinCount, 0);
+    for (uint32_t pin = 0; pin < net.pinCount; pin++) {
+        if (alias[pin] == pin) {
+            connectors[pinMap[pin]] = net.connectors[pin];
+            newState[pinMap[pin]] = state[pin];
+        } else if (net.connectors[pin])
+            net.aliases.emplace_back(net.connectors[pin], pin);
+    }
+    std::vector<uint32_t> sweptPins;
+    for (uint32_t pin = 0; pin < net.pinCount; pin++)
+        if (swept[pin])
+            sweptPins.push_back(pinMap[pin]);
+
+    net.ops = std::move(ops);
+    net.inputStart = std::move(inputStart);
+    net.inputPins = std::move(inputPins);
+    net.linkSrc = std::move(linkSrc);
+    net.connectors = std::move(connectors);
+    for (uint32_t &pin: net.circuitInputs)
+        pin = pinMap[pin];
+    for (uint32_t &pin: net.circuitOutputs)
+        pin = pinMap[pin];
+    for (uint32_t &pin: net.linkObjectPins)
+        pin = pinMap[pin];
+    for (auto &a: net.aliases)
+        a.second = pinMap[a.second];
+    for (uint32_t &pin: net.instancePins)
+        pin = pinMap[pin];
+    net.gateCount = gateCount;
+    net.linkBase = linkBase;
+    net.floatingBase = floatingBase;
+    net.pinCount = pinCount;
+    net.sweptPins = std::move(sweptPins);
+
+    // Single partition ranges, links ordered by reader
+    std::vector<uint32_t> order = net.partition(1);
+    state.assign(pinCount, 0);
+    for (uint32_t pin = 0; pin < pinCount; pin++)
+        state[order[pin]] = newState[pin];
+}
+
+}
+
+OptimizeReport optimizeNetlist(Netlist &net, std::vector<uint8_t> &state, const OptimizeOptions &options,
+                               bool zeroDelay, const std::vector<const Connector *> &observed) {
+    OptimizeReport report;
+    Pass pass(net, state);
+    if (options.constants)
+        pass.propagateConstants(report);
+    if (options.notPairs && zeroDelay)
+        pass.foldNotPairs(report);
+    if (options.merge)
+        pass.mergeGates(report);
+    if (options.sweep)
+        pass.sweep(report, observed);
+    pass.rebuild();
+    net.zeroDelay = zeroDelay && report.notPairs > 0;
+    return report;
+}
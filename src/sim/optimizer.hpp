@@ -0,0 +1,35 @@
+// Netlist passes run between compiling and simulating, so fewer gates & links are evaluated every tick.
+//
+//   constants   pins that keep their value forever (TRUE outputs, unconnected inputs, then gates & linked inputs
+//               only reading constants and already showing the value they compute) stop being computed
+//   NOT pairs   a NOT reading a NOT reads what the first one reads. Only exact with zero delay links (settle
+//               engine), with unit delay the pair is a two tick delay line
+//   merge       gates of the same operation reading the same pins and showing the same states stay equal, one of
+//               them is enough
+//   dead sweep  gates & links no observed pin depends on are dropped, the pins they wrote stop changing
+//
+// Connectors of a removed pin become aliases of the pin holding their value, so the editor shows the same states.
+// Constant pins are kept, they simply stop changing.
+
+#pragma once
+
+#include "netlist.hpp"
+
+struct OptimizeOptions {
+    bool constants = true;
+    bool notPairs = false; // only applied to netlists compiled for zero delay
+    bool merge = true;
+    bool sweep = false;
+};
+
+struct OptimizeReport {
+    uint32_t constantGates = 0;
+    uint32_t notPairs = 0;
+    uint32_t mergedGates = 0;
+    uint32_t deadGates = 0;
+    uint32_t removedLinks = 0;
+};
+
+// `state` (one byte per pin) is remapped along. The sweep keeps circuit outputs and the `observed` connectors.
+OptimizeReport optimizeNetlist(Netlist &net, std::vector<uint8_t> &state, const OptimizeOptions &options,
+                               bool zeroDelay, const std::vector<const Connector *> &observed);
@@ -0,0 +1,36 @@
+// One bit per pin, for storing & comparing whole simulation states.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+inline uint32_t packedWordCount(uint32_t pinCount) {
+    return (pinCount + 63) / 64;
+}
+
+inline void packPins(const uint8_t *pins, uint32_t count, std::vector<uint64_t> &packed) {
+    packed.assign(packedWordCount(count), 0);
+    for (uint32_t w = 0; w < packed.size(); w++) {
+        uint32_t first = w * 64;
+        uint32_t n = count - first < 64 ? count - first : 64;
+        uint64_t word = 0;
+        for (uint32_t i = 0; i < n; i++)
+            word |= (uint64_t) (pins[first + i] & 1) << i;
+        packed[w] = word;
+    }
+}
+
+inline void unpackPins(const std::vector<uint64_t> &packed, uint8_t *pins, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++)
+        pins[i] = (uint8_t) ((packed[i / 64] >> (i % 64)) & 1);
+}
+
+inline uint64_t hashPacked(const std::vector<uint64_t> &packed) {
+    uint64_t hash = 0x9E3779B97F4A7C15ull ^ packed.size();
+    for (uint64_t word: packed) {
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 32;
+    }
+    return hash;
+}
@@ -0,0 +1,216 @@
+#include "partitioner.hpp"
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+
+namespace {
+
+// Undirected weighted graph, adjacency in CSR form.
+struct Graph {
+    std::vector<uint32_t> weight;
+    std::vector<uint32_t> start;
+    std::vector<uint32_t> adj;
+    std::vector<uint32_t> adjWeight;
+
+    uint32_t size() const { return (uint32_t) weight.size(); }
+};
+
+using Edge = std::tuple<uint32_t, uint32_t, uint32_t>; // (u, v, weight)
+
+// Edges must be given in both directions, duplicates are merged.
+Graph makeGraph(std::vector<uint32_t> weight, std::vector<Edge> &edges) {
+    std::sort(edges.begin(), edges.end());
+    Graph g;
+    g.weight = std::move(weight);
+    g.start.assign(g.size() + 1, 0);
+    for (size_t i = 0; i < edges.size(); i++) {
+        auto [u, v, w] = edges[i];
+        if (!g.adj.empty() && i > 0 && std::get<0>(edges[i - 1]) == u && std::get<1>(edges[i - 1]) == v) {
+            g.adjWeight.back() += w;
+            continue;
+        }
+        g.adj.push_back(v);
+        g.adjWeight.push_back(w);
+        g.start[u + 1]++;
+    }
+    for (uint32_t i = 0; i < g.size(); i++)
+        g.start[i + 1] += g.start[i];
+    return g;
+}
+
+// Gates linked together, whatever the direction.
+Graph buildGateGraph(const Netlist &net) {
+    std::vector<uint32_t> readerStart, readers;
+    net.buildGateFanout(readerStart, readers);
+    std::vector<Edge> edges;
+    edges.reserve(net.getLinkCount() * 2);
+    for (uint32_t j = 0; j < net.getLinkCount(); j++) {
+        uint32_t src = net.linkSrc[j];
+        uint32_t pin = net.linkBase + j;
+        if (src >= net.gateCount)
+            continue;
+        for (uint32_t k = readerStart[pin]; k < readerStart[pin + 1]; k++)
+            if (readers[k] != src) {
+                edges.emplace_back(src, readers[k], 1);
+                edges.emplace_back(readers[k], src, 1);
+            }
+    }
+    return makeGraph(std::vector<uint32_t>(net.gateCount, 1), edges);
+}
+
+// Heavy edge matching, returns the coarse graph and fills `map` (fine vertex -> coarse vertex).
+Graph coarsen(const Graph &g, uint32_t maxWeight, std::vector<uint32_t> &map) {
+    const uint32_t n = g.size();
+    std::vector<uint32_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    uint64_t seed = 0x2545F4914F6CDD1Dull; // fixed seed, partitions must be reproducible
+    for (uint32_t i = n; i > 1; i--) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        std::swap(order[i - 1], order[seed % i]);
+    }
+
+    const uint32_t UNMATCHED = UINT32_MAX;
+    map.assign(n, UNMATCHED);
+    std::vector<uint32_t> coarseWeight;
+    for (uint32_t u: order) {
+        if (map[u] != UNMATCHED)
+            continue;
+        uint32_t best = UNMATCHED, bestWeight = 0;
+        for (uint32_t k = g.start[u]; k < g.start[u + 1]; k++) {
+            uint32_t v = g.adj[k];
+            if (map[v] == UNMATCHED && v != u && g.adjWeight[k] > bestWeight &&
+                g.weight[u] + g.weight[v] <= maxWeight) {
+                best = v;
+                bestWeight = g.adjWeight[k];
+            }
+        }
+        map[u] = (uint32_t) coarseWeight.size();
+        coarseWeight.push_back(g.weight[u]);
+        if (best != UNMATCHED) {
+            map[best] = map[u];
+            coarseWeight.back() += g.weight[best];
+        }
+    }
+
+    std::vector<Edge> edges;
+    edges.reserve(g.adj.size());
+    for (uint32_t u = 0; u < n; u++)
+        for (uint32_t k = g.start[u]; k < g.start[u + 1]; k++)
+            if (map[u] != map[g.adj[k]])
+                edges.emplace_back(map[u], map[g.adj[k]], g.adjWeight[k]);
+    return makeGraph(std::move(coarseWeight), edges);
+}
+
+// Grow regions breadth first, cutting the visit order into equal weights.
+std::vector<uint32_t> initialPartition(const Graph &g, uint32_t parts) {
+    const uint32_t n = g.size();
+    uint64_t total = std::accumulate(g.weight.begin(), g.weight.end(), (uint64_t) 0);
+    std::vector<uint32_t> part(n, 0);
+    std::vector<uint8_t> visited(n, 0);
+    std::vector<uint32_t> queue;
+    queue.reserve(n);
+    uint64_t sum = 0;
+    for (uint32_t root = 0; root < n; root++) {
+        if (visited[root])
+            continue;
+        visited[root] = 1;
+        size_t head = queue.size();
+        queue.push_back(root);
+        while (head < queue.size()) {
+            uint32_t u = queue[head++];
+            part[u] = (uint32_t) std::min<uint64_t>(parts - 1, (sum + g.weight[u] / 2) * parts / std::max<uint64_t>(total, 1));
+            sum += g.weight[u];
+            for (uint32_t k = g.start[u]; k < g.start[u + 1]; k++)
+                if (!visited[g.adj[k]]) {
+                    visited[g.adj[k]] = 1;
+                    queue.push_back(g.adj[k]);
+                }
+        }
+    }
+    return part;
+}
+
+// Move boundary vertices to the partition they are most connected to, as long as sizes stay balanced.
+void refine(const Graph &g, std::vector<uint32_t> &part, uint32_t parts, uint64_t maxWeight) {
+    const uint32_t n = g.size();
+    std::vector<uint64_t> partWeight(parts, 0);
+    for (uint32_t u = 0; u < n; u++)
+        partWeight[part[u]] += g.weight[u];
+    std::vector<uint32_t> connection(parts, 0);
+    std::vector<uint32_t> touched;
+
+    for (int pass = 0; pass < 8; pass++) {
+        uint32_t moves = 0;
+        for (uint32_t u = 0; u < n; u++) {
+            uint32_t own = part[u];
+            touched.clear();
+            for (uint32_t k = g.start[u]; k < g.start[u + 1]; k++) {
+                uint32_t p = part[g.adj[k]];
+                if (!connection[p])
+                    touched.push_back(p);
+                connection[p] += g.adjWeight[k];
+            }
+            uint32_t best = own;
+            int64_t bestGain = 0;
+            for (uint32_t p: touched) {
+                if (p == own || partWeight[p] + g.weight[u] > maxWeight)
+                    continue;
+                int64_t gain = (int64_t) connection[p] - connection[own];
+                // equal cut : only move toward the lighter side
+                if (gain > bestGain || (gain == 0 && best == own && partWeight[p] + g.weight[u] < partWeight[own])) {
+                    best = p;
+                    bestGain = gain;
+                }
+            }
+            for (uint32_t p: touched)
+                connection[p] = 0;
+            if (best != own) {
+                partWeight[own] -= g.weight[u];
+                partWeight[best] += g.weight[u];
+                part[u] = best;
+                moves++;
+            }
+        }
+        if (!moves)
+            break;
+    }
+}
+
+} // namespace
+
+std::vector<uint32_t> partitionGates(const Netlist &net, uint32_t parts) {
+    if (parts <= 1 || net.gateCount == 0)
+        return std::vector<uint32_t>(net.gateCount, 0);
+
+    // ---- Coarsen ----
+    std::vector<Graph> levels;
+    std::vector<std::vector<uint32_t>> maps;
+    levels.push_back(buildGateGraph(net));
+    const uint64_t total = net.gateCount;
+    const uint32_t maxVertex = (uint32_t) std::max<uint64_t>(1, total / (parts * 16));
+    const uint32_t coarsest = std::max(parts * 32, 256u);
+    while (levels.back().size() > coarsest) {
+        std::vector<uint32_t> map;
+        Graph coarse = coarsen(levels.back(), maxVertex, map);
+        if (coarse.size() > levels.back().size() * 95 / 100)
+            break;
+        levels.push_back(std::move(coarse));
+        maps.push_back(std::move(map));
+    }
+
+    // ---- Split & refine back up ----
+    uint64_t maxWeight = (total + parts - 1) / parts * (100 + PARTITION_IMBALANCE) / 100 + maxVertex;
+    std::vector<uint32_t> part = initialPartition(levels.back(), parts);
+    refine(levels.back(), part, parts, maxWeight);
+    for (size_t level = levels.size() - 1; level > 0; level--) {
+        const std::vector<uint32_t> &map = maps[level - 1];
+        std::vector<uint32_t> fine(map.size());
+        for (size_t v = 0; v < map.size(); v++)
+            fine[v] = part[map[v]];
+        part = std::move(fine);
+        refine(levels[level - 1], part, parts, maxWeight);
+    }
+    return part;
+}
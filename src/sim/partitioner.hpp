@@ -0,0 +1,17 @@
+// Balanced min-cut partitioning of the gate graph, used to give each worker a connected region of the circuit.
+//
+// Multilevel scheme : gates connected by links are merged (heavy edge matching) until the graph is small,
+// the coarse graph is split by growing regions breadth first, then every level is refined on the way back up
+// by moving boundary vertices to the neighbor partition they share the most links with.
+
+#pragma once
+
+#include "netlist.hpp"
+#include <cstdint>
+#include <vector>
+
+// Allowed partition size above the average, in percent.
+constexpr uint32_t PARTITION_IMBALANCE = 5;
+
+// Partition of every gate, in [0, parts).
+std::vector<uint32_t> partitionGates(const Netlist &net, uint32_t parts);
@@ -0,0 +1,104 @@
+#include "pdes_engine.hpp"
+#include <algorithm>
+#include <map>
+
+void PdesEngine::build(const Netlist &netlist, uint32_t lookahead) {
+    net = &netlist;
+    depth = std::max(lookahead, 1u);
+    const uint32_t parts = netlist.partitionCount;
+
+    std::vector<uint32_t> gatePart(netlist.gateCount, 0);
+    for (uint32_t k = 0; k < parts; k++)
+        for (uint32_t g = netlist.opStart[k * Netlist::OP_COUNT]; g < netlist.opStart[(k + 1) * Netlist::OP_COUNT]; g++)
+            gatePart[g] = k;
+
+    // ---- One channel per (producer, consumer) pair of partitions ----
+    localSrc = netlist.linkSrc;
+    std::map<std::pair<uint32_t, uint32_t>, Channel *> byPair;
+    channels.clear();
+    for (uint32_t k = 0; k < parts; k++)
+        for (uint32_t j = netlist.linkPartStart[k]; j < netlist.linkPartStart[k + 1]; j++) {
+            uint32_t src = netlist.linkSrc[j];
+            if (src >= netlist.gateCount || gatePart[src] == k)
+                continue;
+            Channel *&channel = byPair[{gatePart[src], k}];
+            if (!channel) {
+                channels.push_back(std::make_unique<Channel>());
+                channel = channels.back().get();
+                channel->producer = gatePart[src];
+                channel->consumer = k;
+            }
+            channel->srcPins.push_back(src);
+            channel->dstPins.push_back(netlist.linkBase + j);
+            localSrc[j] = netlist.linkBase + j;
+        }
+
+    outgoing.assign(parts, {});
+    incoming.assign(parts, {});
+    for (auto &channel: channels) {
+        channel->ring.assign((size_t) depth * channel->srcPins.size(), 0);
+        outgoing[channel->producer].push_back(channel.get());
+        incoming[channel->consumer].push_back(channel.get());
+    }
+}
+
+void PdesEngine::run(uint8_t *pins, uint64_t ticks, ThreadPool &pool, const GateKernels &kernels) {
+    for (auto &channel: channels) {
+        channel->produced.store(0, std::memory_order_relaxed);
+        channel->consumed.store(0, std::memory_order_relaxed);
+    }
+    stalls = 0;
+    pool.run([&](uint32_t worker) {
+        if (worker < net->partitionCount)
+            runPartition(worker, pins, ticks, kernels);
+    });
+}
+
+void PdesEngine::runPartition(uint32_t k, uint8_t *pins, uint64_t ticks, const GateKernels &kernels) {
+    const Netlist &n = *net;
+    const uint32_t *in = n.inputPins.data();
+    const uint32_t linkFirst = n.linkPartStart[k];
+    const uint32_t linkCount = n.linkPartStart[k + 1] - linkFirst;
+    uint64_t waited = 0;
+
+    auto runGates = [&](auto kernel, NodeOp op) {
+        uint32_t first = n.opBegin(k, op);
+        uint32_t count = n.opEnd(k, op) - first;
+        if (count)
+            kernel(pins, in + n.inputStart[first], first, count);
+    };
+    auto wait = [&](auto &&ready) {
+        if (ready())
+            return;
+        waited++;
+        spinWait(ready);
+    };
+
+    for (uint64_t t = 0; t < ticks; t++) {
+        runGates(kernels.notGates, NodeOp::NOT);
+        runGates(kernels.andGates, NodeOp::AND);
+        runGates(kernels.orGates, NodeOp::OR);
+        runGates(kernels.xorGates, NodeOp::XOR);
+
+        // Publish this tick's outputs once the consumer freed the slot
+        for (Channel *channel: outgoing[k]) {
+            wait([&] { return channel->consumed.load(std::memory_order_acquire) + depth > t; });
+            uint8_t *slot = channel->ring.data() + (t % depth) * channel->srcPins.size();
+            for (size_t i = 0; i < channel->srcPins.size(); i++)
+                slot[i] = pins[channel->srcPins[i]];
+            channel->produced.store(t + 1, std::memory_order_release);
+        }
+
+        if (linkCount)
+            kernels.copyLinks(pins, localSrc.data() + linkFirst, n.linkBase + linkFirst, linkCount);
+
+        for (Channel *channel: incoming[k]) {
+            wait([&] { return channel->produced.load(std::memory_order_acquire) > t; });
+            const uint8_t *slot = channel->ring.data() + (t % depth) * channel->srcPins.size();
+            for (size_t i = 0; i < channel->dstPins.size(); i++)
+                pins[channel->dstPins[i]] = slot[i];
+            channel->consumed.store(t + 1, std::memory_order_release);
+        }
+    }
+    stalls += waited;
+}
@@ -0,0 +1,51 @@
+// Conservative parallel simulation of a partitioned netlist (Chandy-Misra style, without null messages).
+//
+// Every link delays its value by one tick, so a partition only needs the values its neighbors computed during
+// the previous tick. Each partition keeps its own clock and receives the links crossing partitions through a
+// ring buffer per neighbor instead of reading their pins : partitions run up to `lookahead` ticks apart and only
+// wait when a ring buffer is empty (input not produced yet) or full (a consumer is late).
+// Results are the same as lock-step beginUpdate/endUpdate ticks.
+
+#pragma once
+
+#include "kernels.hpp"
+#include "netlist.hpp"
+#include "thread_pool.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class PdesEngine {
+public:
+    // Ticks a partition may run ahead of the partitions reading it.
+    void build(const Netlist &net, uint32_t lookahead);
+
+    // Run `ticks` ticks, partition k on worker k : the pool must have net.partitionCount threads.
+    void run(uint8_t *pins, uint64_t ticks, ThreadPool &pool, const GateKernels &kernels);
+
+    // Ticks partitions spent waiting on a neighbor during the last run.
+    uint64_t getStallCount() const { return stalls; }
+
+private:
+    // Cut links from one partition to another, `depth` ticks of values.
+    struct Channel {
+        uint32_t producer;
+        uint32_t consumer;
+        std::vector<uint32_t> srcPins; // gate outputs of the producer
+        std::vector<uint32_t> dstPins; // link pins of the consumer
+        std::vector<uint8_t> ring;     // depth * srcPins.size()
+        alignas(64) std::atomic<uint64_t> produced{0}; // ticks written
+        alignas(64) std::atomic<uint64_t> consumed{0}; // ticks read
+    };
+
+    const Netlist *net = nullptr;
+    uint32_t depth = 1;
+    std::vector<uint32_t> localSrc; // linkSrc, cut links copy themselves and are filled from their channel
+    std::vector<std::unique_ptr<Channel>> channels;
+    std::vector<std::vector<Channel *>> outgoing; // per partition
+    std::vector<std::vector<Channel *>> incoming;
+    std::atomic<uint64_t> stalls{0};
+
+    void runPartition(uint32_t k, uint8_t *pins, uint64_t ticks, const GateKernels &kernels);
+};
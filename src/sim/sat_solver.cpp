@@ -0,0 +1,367 @@
+#include "sat_solver.hpp"
+#include <algorithm>
+
+// 1, 1, 2, 1, 1, 2, 4, 1, 1, 2, ...
+static uint64_t luby(uint32_t x) {
+    uint32_t size = 1, sequence = 0;
+    while (size < x + 1) {
+        sequence++;
+        size = 2 * size + 1;
+    }
+    while (size - 1 != x) {
+        size = (size - 1) >> 1;
+        sequence--;
+        x = x % size;
+    }
+    return 1ull << sequence;
+}
+
+uint32_t SatSolver::newVar() {
+    uint32_t var = (uint32_t) assigns.size();
+    assigns.push_back(UNDEF);
+    phases.push_back(FALSE);
+    levels.push_back(0);
+    reasons.push_back(NONE);
+    seen.push_back(0);
+    activity.push_back(0);
+    heapIndex.push_back(NONE);
+    watches.resize(2 * assigns.size());
+    return var;
+}
+
+void SatSolver::reserveVars(uint32_t n) {
+    while (assigns.size() < n)
+        newVar();
+}
+
+bool SatSolver::addClause(std::vector<uint32_t> lits) {
+    if (!ok)
+        return false;
+    std::sort(lits.begin(), lits.end());
+    size_t j = 0;
+    for (size_t i = 0; i < lits.size(); i++) {
+        uint32_t lit = lits[i];
+        if (value(lit) == TRUE || (j > 0 && lits[j - 1] == (lit ^ 1)))
+            return true;
+        if (value(lit) == FALSE || (j > 0 && lits[j - 1] == lit))
+            continue;
+        lits[j++] = lit;
+    }
+    lits.resize(j);
+    if (lits.empty())
+        return ok = false;
+    if (lits.size() == 1) {
+        assign(lits[0], NONE);
+        return ok = propagate() == NONE;
+    }
+    for (uint32_t lit: lits)
+        heapInsert(lit >> 1);
+    attach(std::move(lits), false);
+    return true;
+}
+
+uint32_t SatSolver::attach(std::vector<uint32_t> lits, bool learnt) {
+    uint32_t id = (uint32_t) clauses.size();
+    watches[lits[0]].push_back(Watcher{id, lits[1]});
+    watches[lits[1]].push_back(Watcher{id, lits[0]});
+    clauses.push_back(Clause{std::move(lits), 0, learnt, false});
+    if (learnt)
+        learnts.push_back(id);
+    return id;
+}
+
+void SatSolver::assign(uint32_t lit, uint32_t reason) {
+    uint32_t var = lit >> 1;
+    assigns[var] = (uint8_t) (TRUE ^ (lit & 1));
+    levels[var] = decisionLevel();
+    reasons[var] = reason;
+    trail.push_back(lit);
+}
+
+// Returns the conflicting clause, NONE when every watched clause is fine.
+uint32_t SatSolver::propagate() {
+    while (propagated < trail.size()) {
+        uint32_t falseLit = trail[propagated++] ^ 1;
+        std::vector<Watcher> &ws = watches[falseLit];
+        size_t i = 0, j = 0;
+        while (i < ws.size()) {
+            Watcher w = ws[i++];
+            if (value(w.blocker) == TRUE) {
+                ws[j++] = w;
+                continue;
+            }
+            Clause &c = clauses[w.clause];
+            if (c.deleted)
+                continue;
+            // The false literal goes to position 1, position 0 is what this clause may imply
+            if (c.lits[0] == falseLit)
+                std::swap(c.lits[0], c.lits[1]);
+            uint32_t first = c.lits[0];
+            if (first != w.blocker && value(first) == TRUE) {
+                ws[j++] = Watcher{w.clause, first};
+                continue;
+            }
+            bool moved = false;
+            for (size_t k = 2; k < c.lits.size(); k++)
+                if (value(c.lits[k]) != FALSE) {
+                    std::swap(c.lits[1], c.lits[k]);
+                    watches[c.lits[1]].push_back(Watcher{w.clause, first});
+                    moved = true;
+                    break;
+                }
+            if (moved)
+                continue;
+            ws[j++] = Watcher{w.clause, first};
+            if (value(first) == FALSE) {
+                while (i < ws.size())
+                    ws[j++] = ws[i++];
+                ws.resize(j);
+                propagated = (uint32_t) trail.size();
+                return w.clause;
+            }
+            assign(first, w.clause);
+        }
+        ws.resize(j);
+    }
+    return NONE;
+}
+
+// First UIP clause of `conflict`, the asserting literal first and a literal of the backtrack level second.
+void SatSolver::analyze(uint32_t conflict, std::vector<uint32_t> &learnt, uint32_t &backtrackLevel) {
+    learnt.assign(1, NONE);
+    uint32_t pending = 0, p = NONE;
+    size_t index = trail.size();
+    do {
+        Clause &c = clauses[conflict];
+        if (c.learnt)
+            bumpClause(c);
+        for (size_t j = p == NONE ? 0 : 1; j < c.lits.size(); j++) {
+            uint32_t q = c.lits[j], var = q >> 1;
+            if (seen[var] || levels[var] == 0)
+                continue;
+            seen[var] = 1;
+            bumpVar(var);
+            if (levels[var] >= decisionLevel())
+                pending++;
+            else
+                learnt.push_back(q);
+        }
+        while (!seen[trail[--index] >> 1]);
+        p = trail[index];
+        conflict = reasons[p >> 1];
+        seen[p >> 1] = 0;
+        pending--;
+    } while (pending > 0);
+    learnt[0] = p ^ 1;
+
+    // Drop literals implied by the others
+    std::vector<uint32_t> marked(learnt.begin() + 1, learnt.end());
+    size_t j = 1;
+    for (size_t i = 1; i < learnt.size(); i++)
+        if (!redundant(learnt[i]))
+            learnt[j++] = learnt[i];
+    learnt.resize(j);
+    for (uint32_t lit: marked)
+        seen[lit >> 1] = 0;
+
+    backtrackLevel = 0;
+    for (size_t i = 1; i < learnt.size(); i++)
+        if (levels[learnt[i] >> 1] > backtrackLevel) {
+            backtrackLevel = levels[learnt[i] >> 1];
+            std::swap(learnt[1], learnt[i]);
+        }
+}
+
+bool SatSolver::redundant(uint32_t lit) const {
+    uint32_t reason = reasons[lit >> 1];
+    if (reason == NONE)
+        return false;
+    const std::vector<uint32_t> &lits = clauses[reason].lits;
+    for (size_t k = 1; k < lits.size(); k++)
+        if (!seen[lits[k] >> 1] && levels[lits[k] >> 1] > 0)
+            return false;
+    return true;
+}
+
+void SatSolver::cancelUntil(uint32_t level) {
+    if (decisionLevel() <= level)
+        return;
+    for (size_t i = trail.size(); i-- > trailLimits[level];) {
+        uint32_t var = trail[i] >> 1;
+        phases[var] = assigns[var];
+        assigns[var] = UNDEF;
+        reasons[var] = NONE;
+        heapInsert(var);
+    }
+    trail.resize(trailLimits[level]);
+    trailLimits.resize(level);
+    propagated = (uint32_t) trail.size();
+}
+
+// Drop the less active half of the learnt clauses, keeping the ones that are reasons & the binary ones.
+void SatSolver::reduceLearnts() {
+    std::sort(learnts.begin(), learnts.end(),
+              [&](uint32_t a, uint32_t b) { return clauses[a].activity < clauses[b].activity; });
+    size_t j = 0;
+    for (size_t i = 0; i < learnts.size(); i++) {
+        Clause &c = clauses[learnts[i]];
+        bool locked = reasons[c.lits[0] >> 1] == learnts[i] && value(c.lits[0]) == TRUE;
+        if (i < learnts.size() / 2 && !locked && c.lits.size() > 2) {
+            c.deleted = true;
+            std::vector<uint32_t>().swap(c.lits);
+        } else
+            learnts[j++] = learnts[i];
+    }
+    learnts.resize(j);
+    maxLearnts *= 1.1;
+}
+
+void SatSolver::bumpVar(uint32_t var) {
+    if ((activity[var] += varIncrement) > 1e100) {
+        for (double &a: activity)
+            a *= 1e-100;
+        varIncrement *= 1e-100;
+    }
+    if (heapIndex[var] != NONE)
+        heapUp(heapIndex[var]);
+}
+
+void SatSolver::bumpClause(Clause &c) {
+    if ((c.activity += clauseIncrement) > 1e20) {
+        for (uint32_t id: learnts)
+            clauses[id].activity *= 1e-20;
+        clauseIncrement *= 1e-20;
+    }
+}
+
+SatSolver::Result SatSolver::solve(const std::vector<uint32_t> &assumptions, uint64_t conflictLimit) {
+    model.clear();
+    if (!ok)
+        return Result::UNSAT;
+    maxLearnts = std::max(maxLearnts, (double) clauses.size() / 3 + 1000);
+    const uint64_t start = conflicts;
+    for (uint32_t restart = 0;; restart++) {
+        uint64_t budget = luby(restart) * 100;
+        if (conflictLimit) {
+            if (conflicts - start >= conflictLimit)
+                return Result::UNKNOWN;
+            budget = std::min(budget, conflictLimit - (conflicts - start));
+        }
+        Result result = search(budget, assumptions);
+        cancelUntil(0);
+        if (result != Result::UNKNOWN)
+            return result;
+    }
+}
+
+// UNKNOWN once `conflictBudget` conflicts happened, the caller restarts.
+SatSolver::Result SatSolver::search(uint64_t conflictBudget, const std::vector<uint32_t> &assumptions) {
+    const uint64_t start = conflicts;
+    std::vector<uint32_t> learnt;
+    for (;;) {
+        uint32_t conflict = propagate();
+        if (conflict != NONE) {
+            conflicts++;
+            if (decisionLevel() == 0) {
+                ok = false;
+                return Result::UNSAT;
+            }
+            uint32_t backtrackLevel;
+            analyze(conflict, learnt, backtrackLevel);
+            cancelUntil(backtrackLevel);
+            if (learnt.size() == 1)
+                assign(learnt[0], NONE);
+            else {
+                uint32_t id = attach(learnt, true);
+                bumpClause(clauses[id]);
+                assign(learnt[0], id);
+            }
+            varIncrement /= 0.95;
+            clauseIncrement /= 0.999;
+            continue;
+        }
+
+        if (conflicts - start >= conflictBudget)
+            return Result::UNKNOWN;
+        if ((double) learnts.size() >= maxLearnts + (double) trail.size())
+            reduceLearnts();
+
+        // Assumptions first, one decision level each
+        uint32_t next = NONE;
+        while (decisionLevel() < assumptions.size()) {
+            uint32_t p = assumptions[decisionLevel()];
+            if (value(p) == TRUE)
+                trailLimits.push_back((uint32_t) trail.size());
+            else if (value(p) == FALSE)
+                return Result::UNSAT;
+            else {
+                next = p;
+                break;
+            }
+        }
+        if (next == NONE) {
+            uint32_t var = NONE;
+            while (!heap.empty() && assigns[var = heapPop()] != UNDEF)
+                var = NONE;
+            if (var == NONE) {
+                model = assigns;
+                return Result::SAT;
+            }
+            next = var << 1 | (phases[var] == FALSE);
+        }
+        trailLimits.push_back((uint32_t) trail.size());
+        assign(next, NONE);
+    }
+}
+
+void SatSolver::heapInsert(uint32_t var) {
+    if (heapIndex[var] != NONE)
+        return;
+    heapIndex[var] = (uint32_t) heap.size();
+    heap.push_back(var);
+    heapUp(heapIndex[var]);
+}
+
+void SatSolver::heapUp(uint32_t i) {
+    uint32_t var = heap[i];
+    while (i > 0) {
+        uint32_t parent = (i - 1) >> 1;
+        if (activity[heap[parent]] >= activity[var])
+            break;
+        heap[i] = heap[parent];
+        heapIndex[heap[i]] = i;
+        i = parent;
+    }
+    heap[i] = var;
+    heapIndex[var] = i;
+}
+
+void SatSolver::heapDown(uint32_t i) {
+    uint32_t var = heap[i];
+    for (;;) {
+        uint32_t child = 2 * i + 1;
+        if (child >= heap.size())
+            break;
+        if (child + 1 < heap.size() && activity[heap[child + 1]] > activity[heap[child]])
+            child++;
+        if (activity[heap[child]] <= activity[var])
+            break;
+        heap[i] = heap[child];
+        heapIndex[heap[i]] = i;
+        i = child;
+    }
+    heap[i] = var;
+    heapIndex[var] = i;
+}
+
+uint32_t SatSolver::heapPop() {
+    uint32_t var = heap[0];
+    heapIndex[var] = NONE;
+    heap[0] = heap.back();
+    heap.pop_back();
+    if (!heap.empty()) {
+        heapIndex[heap[0]] = 0;
+        heapDown(0);
+    }
+    return var;
+}
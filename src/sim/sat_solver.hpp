@@ -0,0 +1,113 @@
+// Small CDCL SAT solver for the equivalence checker (see sim/equivalence.hpp).
+//
+// Two watched literals, first UIP learning, VSIDS branching with phase saving, Luby restarts and learnt clause
+// reduction. Literals use the AIG encoding, 2 * variable + negation, so AIG literals can be passed as they are.
+// Clauses are only added at decision level 0, between solve() calls.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class SatSolver {
+public:
+    enum class Result {
+        SAT,
+        UNSAT,
+        UNKNOWN // conflict budget exhausted
+    };
+
+    // Variables are only branched on once a clause uses them, so a solver can hold many more than a query needs.
+    uint32_t newVar();
+
+    // Make variables [0, n) exist.
+    void reserveVars(uint32_t n);
+
+    uint32_t getVarCount() const { return (uint32_t) assigns.size(); }
+
+    // False once the clauses alone are unsatisfiable.
+    bool addClause(std::vector<uint32_t> lits);
+
+    // Solve under `assumptions`, UNKNOWN after `conflictLimit` conflicts (0 for no limit).
+    Result solve(const std::vector<uint32_t> &assumptions, uint64_t conflictLimit = 0);
+
+    // Value of `var` in the last SAT model.
+    bool modelValue(uint32_t var) const { return var < model.size() && model[var] == TRUE; }
+
+    uint64_t getConflictCount() const { return conflicts; }
+
+private:
+    static constexpr uint8_t FALSE = 0, TRUE = 1, UNDEF = 2;
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Clause {
+        std::vector<uint32_t> lits;
+        double activity = 0;
+        bool learnt = false;
+        bool deleted = false;
+    };
+
+    struct Watcher {
+        uint32_t clause;
+        uint32_t blocker;
+    };
+
+    bool ok = true;
+    std::vector<Clause> clauses;
+    std::vector<uint32_t> learnts;
+    std::vector<std::vector<Watcher>> watches; // per literal, clauses watching it
+    std::vector<uint8_t> assigns;              // per var
+    std::vector<uint8_t> phases;
+    std::vector<uint32_t> levels;
+    std::vector<uint32_t> reasons;
+    std::vector<uint32_t> trail;
+    std::vector<uint32_t> trailLimits;
+    uint32_t propagated = 0;
+    std::vector<uint8_t> model;
+    std::vector<uint8_t> seen;
+
+    std::vector<double> activity;
+    double varIncrement = 1;
+    double clauseIncrement = 1;
+    std::vector<uint32_t> heap;
+    std::vector<uint32_t> heapIndex; // NONE when not in the heap
+
+    uint64_t conflicts = 0;
+    double maxLearnts = 0;
+
+    uint8_t value(uint32_t lit) const {
+        uint8_t v = assigns[lit >> 1];
+        return v == UNDEF ? UNDEF : (uint8_t) (v ^ (lit & 1));
+    }
+
+    uint32_t decisionLevel() const { return (uint32_t) trailLimits.size(); }
+
+    void assign(uint32_t lit, uint32_t reason);
+
+    uint32_t propagate();
+
+    void analyze(uint32_t conflict, std::vector<uint32_t> &learnt, uint32_t &backtrackLevel);
+
+    bool redundant(uint32_t lit) const;
+
+    void cancelUntil(uint32_t level);
+
+    uint32_t attach(std::vector<uint32_t> lits, bool learnt);
+
+    void reduceLearnts();
+
+    void bumpVar(uint32_t var);
+
+    void bumpClause(Clause &c);
+
+    Result search(uint64_t conflictBudget, const std::vector<uint32_t> &assumptions);
+
+    // Max-activity heap of unassigned variables
+    void heapInsert(uint32_t var);
+
+    void heapUp(uint32_t i);
+
+    void heapDown(uint32_t i);
+
+    uint32_t heapPop();
+};
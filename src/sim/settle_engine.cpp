@@ -0,0 +1,290 @@
+#include "settle_engine.hpp"
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+
+namespace {
+
+// Strongly connected components of a graph, levelized in topological order.
+struct Components {
+    std::vector<std::vector<uint32_t>> members; // reverse topological order
+    std::vector<uint32_t> of;                   // component of each vertex
+    std::vector<uint32_t> level;
+    std::vector<uint8_t> loop;
+    uint32_t loopCount = 0;
+    uint32_t depth = 0;
+};
+
+Components findComponents(uint32_t n, const std::vector<uint32_t> &succStart, const std::vector<uint32_t> &succ) {
+    Components result;
+    std::vector<std::vector<uint32_t>> &components = result.members;
+    std::vector<uint32_t> &component = result.of;
+    component.assign(n, 0);
+
+    // ---- Tarjan's strongly connected components, iterative so long chains don't overflow the stack ----
+    const uint32_t UNVISITED = UINT32_MAX;
+    std::vector<uint32_t> index(n, UNVISITED), low(n, 0);
+    std::vector<uint8_t> onStack(n, 0);
+    std::vector<uint32_t> stack;
+    std::vector<std::pair<uint32_t, uint32_t>> callStack; // (vertex, next successor offset)
+    uint32_t counter = 0;
+    for (uint32_t root = 0; root < n; root++) {
+        if (index[root] != UNVISITED)
+            continue;
+        callStack.emplace_back(root, succStart[root]);
+        index[root] = low[root] = counter++;
+        stack.push_back(root);
+        onStack[root] = 1;
+        while (!callStack.empty()) {
+            uint32_t v = callStack.back().first;
+            uint32_t &next = callStack.back().second;
+            if (next < succStart[v + 1]) {
+                uint32_t w = succ[next++];
+                if (index[w] == UNVISITED) {
+                    index[w] = low[w] = counter++;
+                    stack.push_back(w);
+                    onStack[w] = 1;
+                    callStack.emplace_back(w, succStart[w]);
+                } else if (onStack[w])
+                    low[v] = std::min(low[v], index[w]);
+                continue;
+            }
+            callStack.pop_back();
+            if (!callStack.empty())
+                low[callStack.back().first] = std::min(low[callStack.back().first], low[v]);
+            if (low[v] == index[v]) {
+                components.emplace_back();
+                uint32_t w;
+                do {
+                    w = stack.back();
+                    stack.pop_back();
+                    onStack[w] = 0;
+                    component[w] = (uint32_t) components.size() - 1;
+                    components.back().push_back(w);
+                } while (w != v);
+            }
+        }
+    }
+
+    // ---- Levelize components in topological order ----
+    const uint32_t count = (uint32_t) components.size();
+    result.level.assign(count, 0);
+    result.loop.assign(count, 0);
+    for (uint32_t c = count; c-- > 0;) {
+        bool loop = components[c].size() > 1;
+        for (uint32_t v: components[c])
+            for (uint32_t k = succStart[v]; k < succStart[v + 1]; k++) {
+                uint32_t s = component[succ[k]];
+                if (s == c)
+                    loop = true;
+                else
+                    result.level[s] = std::max(result.level[s], result.level[c] + 1);
+            }
+        result.loop[c] = loop;
+        result.loopCount += loop;
+        result.depth = std::max(result.depth, result.level[c] + 1);
+    }
+    return result;
+}
+
+// What a region reads : the source of a linked input driven from outside, or the pin itself
+uint32_t readPin(const Netlist &net, uint32_t pin) {
+    return pin >= net.linkBase && pin < net.floatingBase ? net.linkSrc[pin - net.linkBase] : pin;
+}
+
+uint32_t countInputs(const Netlist &net, const std::vector<uint32_t> &region) {
+    std::vector<uint32_t> inside(region), read;
+    std::sort(inside.begin(), inside.end());
+    for (uint32_t g: region)
+        for (uint32_t k = net.inputStart[g]; k < net.inputStart[g + 1]; k++) {
+            uint32_t pin = readPin(net, net.inputPins[k]);
+            if (!std::binary_search(inside.begin(), inside.end(), pin))
+                read.push_back(pin);
+        }
+    std::sort(read.begin(), read.end());
+    return (uint32_t) (std::unique(read.begin(), read.end()) - read.begin());
+}
+
+}
+
+void SettleEngine::build(const Netlist &netlist) {
+    net = &netlist;
+    const uint32_t n = netlist.gateCount;
+    netlist.buildLinkFanout(linkFanoutStart, linkFanout);
+    sourceLinks.clear();
+    for (uint32_t j = 0; j < netlist.linkSrc.size(); j++)
+        if (netlist.linkSrc[j] >= n)
+            sourceLinks.push_back(j);
+
+    // gate -> gates reading its output through a link
+    std::vector<uint32_t> gateFanoutStart, gateFanout;
+    netlist.buildGateFanout(gateFanoutStart, gateFanout);
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+    for (uint32_t g = 0; g < n; g++)
+        for (uint32_t k = linkFanoutStart[g]; k < linkFanoutStart[g + 1]; k++) {
+            uint32_t pin = netlist.linkBase + linkFanout[k];
+            for (uint32_t m = gateFanoutStart[pin]; m < gateFanoutStart[pin + 1]; m++)
+                edges.emplace_back(g, gateFanout[m]);
+        }
+    std::vector<uint32_t> succStart, succ;
+    buildCsr(n, edges, succStart, succ);
+
+    Components gates = findComponents(n, succStart, succ);
+    loopCount = gates.loopCount;
+    depth = gates.depth;
+
+    // ---- Candidate regions : the gates of instances free of loops, in topological order ----
+    // Optimized netlists share gates between instances (see sim/optimizer.hpp), the first region keeps them.
+    std::vector<std::vector<uint32_t>> regions;
+    std::vector<uint8_t> owned(n, 0);
+    for (size_t i = 0; maxLutInputs > 0 && i < netlist.instances.size(); i++) {
+        std::vector<uint32_t> region;
+        bool loop = false;
+        for (uint32_t k = netlist.instanceStart[i]; k < netlist.instanceStart[i + 1]; k++) {
+            uint32_t pin = netlist.instancePins[k];
+            if (pin < n && !owned[pin]) {
+                owned[pin] = 1;
+                region.push_back(pin);
+                loop |= gates.loop[gates.of[pin]] != 0;
+            }
+        }
+        if (loop || region.size() < 2 || region.size() > MAX_LUT_GATES || countInputs(netlist, region) > maxLutInputs) {
+            for (uint32_t g: region)
+                owned[g] = 0;
+            continue;
+        }
+        std::stable_sort(region.begin(), region.end(), [&](uint32_t a, uint32_t b) {
+            return gates.level[gates.of[a]] < gates.level[gates.of[b]];
+        });
+        regions.push_back(std::move(region));
+    }
+    buildOrder(regions, succStart, succ);
+    buildLuts(regions);
+    unstableCount = 0;
+}
+
+void SettleEngine::buildOrder(std::vector<std::vector<uint32_t>> &regions, const std::vector<uint32_t> &succStart,
+                              const std::vector<uint32_t> &succ) {
+    const uint32_t n = net->gateCount;
+    std::vector<uint32_t> unitOf(n);
+    Components units;
+    // A region reaching itself through gates outside of it can't be a single step : drop it & try again,
+    // dropping regions never adds loops so the second pass is final.
+    for (bool dropped = true; dropped;) {
+        for (uint32_t g = 0; g < n; g++)
+            unitOf[g] = g;
+        for (uint32_t r = 0; r < regions.size(); r++)
+            for (uint32_t g: regions[r])
+                unitOf[g] = n + r;
+        std::vector<std::pair<uint32_t, uint32_t>> edges;
+        for (uint32_t g = 0; g < n; g++)
+            for (uint32_t k = succStart[g]; k < succStart[g + 1]; k++)
+                if (unitOf[g] != unitOf[succ[k]])
+                    edges.emplace_back(unitOf[g], unitOf[succ[k]]);
+        std::vector<uint32_t> unitStart, unitSucc;
+        const uint32_t unitCount = n + (uint32_t) regions.size();
+        buildCsr(unitCount, edges, unitStart, unitSucc);
+        units = findComponents(unitCount, unitStart, unitSucc);
+
+        size_t kept = 0;
+        for (uint32_t r = 0; r < regions.size(); r++)
+            if (!units.loop[units.of[n + r]])
+                std::swap(regions[kept++], regions[r]);
+        dropped = kept < regions.size();
+        regions.resize(kept);
+    }
+    lutDepth = units.depth;
+
+    const uint32_t count = (uint32_t) units.members.size();
+    std::vector<uint32_t> sorted(count);
+    for (uint32_t c = 0; c < count; c++)
+        sorted[c] = count - 1 - c;
+    std::stable_sort(sorted.begin(), sorted.end(), [&](uint32_t a, uint32_t b) {
+        if (units.level[a] != units.level[b])
+            return units.level[a] < units.level[b];
+        return units.loop[a] < units.loop[b];
+    });
+
+    order.clear();
+    blocks.clear();
+    for (uint32_t c: sorted) {
+        std::vector<uint32_t> &members = units.members[c];
+        // Gates of a region only run through it
+        members.erase(std::remove_if(members.begin(), members.end(), [&](uint32_t u) {
+            return u < n && unitOf[u] != u;
+        }), members.end());
+        if (members.empty())
+            continue;
+        std::sort(members.begin(), members.end()); // gate index order keeps operations grouped
+        uint32_t begin = (uint32_t) order.size();
+        order.insert(order.end(), members.begin(), members.end());
+        bool mergeable = !units.loop[c] && !blocks.empty() && !blocks.back().loop;
+        if (mergeable)
+            blocks.back().end = (uint32_t) order.size();
+        else
+            blocks.push_back({begin, (uint32_t) order.size(), (bool) units.loop[c]});
+    }
+}
+
+void SettleEngine::buildLuts(const std::vector<std::vector<uint32_t>> &regions) {
+    luts.clear();
+    lutGates.clear();
+    lutInputs.clear();
+    tables.clear();
+    // Structure -> table, equal instances share one
+    std::map<std::vector<uint32_t>, uint32_t> tableOf;
+    std::unordered_map<uint32_t, uint32_t> ordinal;
+    std::vector<uint32_t> inputs, shape;
+    const uint32_t LOCAL = 0x80000000u;
+
+    for (const std::vector<uint32_t> &region: regions) {
+        ordinal.clear();
+        inputs.clear();
+        shape.clear();
+        for (uint32_t g: region) {
+            shape.push_back((uint32_t) net->ops[g]);
+            shape.push_back(net->inputStart[g + 1] - net->inputStart[g]);
+            for (uint32_t k = net->inputStart[g]; k < net->inputStart[g + 1]; k++) {
+                uint32_t pin = readPin(*net, net->inputPins[k]);
+                auto local = ordinal.find(pin);
+                if (local != ordinal.end()) {
+                    shape.push_back(LOCAL | local->second);
+                    continue;
+                }
+                auto input = std::find(inputs.begin(), inputs.end(), pin);
+                shape.push_back((uint32_t) (input - inputs.begin()));
+                if (input == inputs.end())
+                    inputs.push_back(pin);
+            }
+            ordinal[g] = (uint32_t) ordinal.size();
+        }
+        shape.push_back((uint32_t) inputs.size());
+
+        auto table = tableOf.find(shape);
+        if (table == tableOf.end()) {
+            table = tableOf.emplace(shape, (uint32_t) tables.size()).first;
+            // Every input combination, through the region gates in order
+            for (uint32_t index = 0; index < (1u << inputs.size()); index++) {
+                uint64_t entry = 0;
+                for (size_t s = 0, i = 0; i < region.size(); i++) {
+                    auto op = (NodeOp) shape[s++];
+                    uint32_t arity = shape[s++];
+                    bool in[2] = {false, false};
+                    for (uint32_t k = 0; k < arity; k++, s++) {
+                        bool value = shape[s] & LOCAL ? (entry >> (shape[s] & ~LOCAL)) & 1 : (index >> shape[s]) & 1;
+                        if (k < 2)
+                            in[k] = value;
+                    }
+                    bool out = op == NodeOp::NOT ? !in[0] : op == NodeOp::AND ? in[0] && in[1] :
+                               op == NodeOp::OR ? in[0] || in[1] : in[0] != in[1];
+                    entry |= (uint64_t) out << i;
+                }
+                tables.push_back(entry);
+            }
+        }
+        luts.push_back({(uint32_t) lutGates.size(), (uint32_t) (lutGates.size() + region.size()),
+                        (uint32_t) lutInputs.size(), (uint32_t) (lutInputs.size() + inputs.size()), table->second});
+        lutGates.insert(lutGates.end(), region.begin(), region.end());
+        lutInputs.insert(lutInputs.end(), inputs.begin(), inputs.end());
+    }
+}
@@ -0,0 +1,158 @@
+// Zero delay evaluation : links act as plain wires and every step settles the whole circuit.
+//
+// Gates are levelized and evaluated in topological order, each output being forwarded through its links
+// right away. Combinational loops (strongly connected components) are iterated until they stop changing.
+//
+// Composite instances without feedback and with few inputs are collapsed into a lookup table computed once per
+// distinct structure : a single lookup gives every gate output of the instance, bit i of an entry being its i-th
+// gate. Zero delay makes this exact, every pin still holds its settled value.
+
+#pragma once
+
+#include "gate_eval.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+class SettleEngine {
+public:
+    void build(const Netlist &net);
+
+    // Settle every lane of `p`, works for any lane word.
+    template<typename Word>
+    void settle(Word *p);
+
+    // Number of levels of the acyclic part.
+    uint32_t getDepth() const { return depth; }
+
+    // Combinational loops found while levelizing.
+    uint32_t getLoopCount() const { return loopCount; }
+
+    // Loops still changing after the iteration limit during the last settle (oscillators).
+    uint32_t getUnstableCount() const { return unstableCount; }
+
+    void setMaxIterations(uint32_t n) { maxIterations = n; }
+
+    // Largest lookup table index, 0 evaluates every gate. Takes effect on the next build().
+    void setMaxLutInputs(uint32_t n) { maxLutInputs = std::min(n, MAX_LUT_INPUTS); }
+
+    uint32_t getLutCount() const { return (uint32_t) luts.size(); }
+
+    // Gates replaced by lookup tables.
+    uint32_t getLutGateCount() const { return (uint32_t) lutGates.size(); }
+
+    // Number of levels once lookup tables stand for their gates.
+    uint32_t getLutDepth() const { return lutDepth; }
+
+    size_t getTableBytes() const { return tables.size() * sizeof(uint64_t); }
+
+    static constexpr uint32_t MAX_LUT_INPUTS = 16;
+    static constexpr uint32_t MAX_LUT_GATES = 64;
+
+private:
+    // Lookup table : gates [gateBegin, gateEnd) of lutGates, index bits read pins [inputBegin, inputEnd) of lutInputs.
+    struct Lut {
+        uint32_t gateBegin;
+        uint32_t gateEnd;
+        uint32_t inputBegin;
+        uint32_t inputEnd;
+        uint32_t table; // offset into tables
+    };
+
+    // Evaluation order : a run of units, iterated when it is a loop. Unit u is gate u, or lut u - gateCount.
+    struct Block {
+        uint32_t begin;
+        uint32_t end;
+        bool loop;
+    };
+
+    const Netlist *net = nullptr;
+    std::vector<uint32_t> order;
+    std::vector<Block> blocks;
+    std::vector<uint32_t> linkFanoutStart; // gate -> links copying its output
+    std::vector<uint32_t> linkFanout;
+    std::vector<uint32_t> sourceLinks;     // links copying a source or unconnected pin
+    std::vector<Lut> luts;
+    std::vector<uint32_t> lutGates;
+    std::vector<uint32_t> lutInputs;
+    std::vector<uint64_t> tables;
+    uint32_t maxLutInputs = MAX_LUT_INPUTS;
+    uint32_t lutDepth = 0;
+    uint32_t depth = 0;
+    uint32_t loopCount = 0;
+    uint32_t unstableCount = 0;
+    uint32_t maxIterations = 64;
+
+    template<typename Word>
+    bool evaluate(Word *p, uint32_t g);
+
+    template<typename Word>
+    void evaluateLut(Word *p, const Lut &lut);
+
+    // Candidate regions, without the ones reaching themselves through other gates. Builds the order.
+    void buildOrder(std::vector<std::vector<uint32_t>> &regions, const std::vector<uint32_t> &succStart,
+                    const std::vector<uint32_t> &succ);
+
+    void buildLuts(const std::vector<std::vector<uint32_t>> &regions);
+};
+
+// Evaluate a gate and forward its output through its links, returns true when the output changed.
+template<typename Word>
+bool SettleEngine::evaluate(Word *p, uint32_t g) {
+    Word value = evaluateGate(*net, p, g);
+    bool changed = value != p[g];
+    p[g] = value;
+    Word *dst = p + net->linkBase;
+    for (uint32_t k = linkFanoutStart[g]; k < linkFanoutStart[g + 1]; k++)
+        dst[linkFanout[k]] = value;
+    return changed;
+}
+
+// Several lanes would need one lookup per lane, their gates are evaluated instead.
+template<typename Word>
+void SettleEngine::evaluateLut(Word *p, const Lut &lut) {
+    if constexpr (LaneTraits<Word>::count > 1) {
+        for (uint32_t k = lut.gateBegin; k < lut.gateEnd; k++)
+            evaluate(p, lutGates[k]);
+    } else {
+        uint32_t index = 0;
+        for (uint32_t k = lut.inputBegin; k < lut.inputEnd; k++)
+            index |= (uint32_t) p[lutInputs[k]] << (k - lut.inputBegin);
+        uint64_t entry = tables[lut.table + index];
+        Word *dst = p + net->linkBase;
+        for (uint32_t k = lut.gateBegin; k < lut.gateEnd; k++, entry >>= 1) {
+            uint32_t g = lutGates[k];
+            Word value = (Word) (entry & 1);
+            p[g] = value;
+            for (uint32_t m = linkFanoutStart[g]; m < linkFanoutStart[g + 1]; m++)
+                dst[linkFanout[m]] = value;
+        }
+    }
+}
+
+template<typename Word>
+void SettleEngine::settle(Word *p) {
+    Word *dst = p + net->linkBase;
+    for (uint32_t j: sourceLinks)
+        dst[j] = p[net->linkSrc[j]];
+
+    unstableCount = 0;
+    for (const Block &block: blocks) {
+        if (!block.loop) {
+            for (uint32_t i = block.begin; i < block.end; i++) {
+                if (order[i] < net->gateCount)
+                    evaluate(p, order[i]);
+                else
+                    evaluateLut(p, luts[order[i] - net->gateCount]);
+            }
+            continue;
+        }
+        bool changed = true;
+        for (uint32_t it = 0; changed && it < maxIterations; it++) {
+            changed = false;
+            for (uint32_t i = block.begin; i < block.end; i++)
+                changed |= evaluate(p, order[i]);
+        }
+        unstableCount += changed;
+    }
+}
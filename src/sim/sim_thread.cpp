@@ -0,0 +1,416 @@
+#include "sim_thread.hpp"
+#include <algorithm>
+#include <unordered_set>
+
+using Clock = std::chrono::steady_clock;
+
+// At most one snapshot per period, a bit faster than the screen refresh. Slower ticks publish each tick
+// with their links moving (between beginUpdate & endUpdate) so the renderer can animate them.
+static constexpr auto PUBLISH_PERIOD = std::chrono::milliseconds(8);
+
+SimulationThread::SimulationThread() : thread(&SimulationThread::run, this) {}
+
+SimulationThread::~SimulationThread() {
+    send(Command{CommandType::STOP});
+    thread.join();
+}
+
+void SimulationThread::send(Command &&command) {
+    while (!commands.push(std::move(command)))
+        std::this_thread::yield(); // full queue, the simulation thread drains it every batch
+    std::lock_guard<std::mutex> lock(wakeMutex);
+    wake.notify_one();
+}
+
+uint64_t SimulationThread::load(const Simulator &front, const StateEdits &edits) {
+    const Netlist &net = front.getNetlist();
+    auto data = std::make_unique<LoadData>();
+    data->netlist = net;
+    front.readPins(data->state);
+    data->version = ++version;
+
+    std::unordered_set<const Connector *> forced(edits.connectors.begin(), edits.connectors.end());
+    std::unordered_map<uint64_t, uint32_t> pinsOf;
+    pinsOf.reserve(net.pinCount);
+    data->remap.assign(net.pinCount, NO_PIN);
+    std::vector<uint64_t> ids = net.getPinIds();
+    for (uint32_t pin = 0; pin < net.pinCount; pin++) {
+        pinsOf[ids[pin]] = pin;
+        if (edits.all || forced.count(net.connectors[pin]))
+            continue;
+        auto previous = sentPins.find(ids[pin]);
+        if (previous != sentPins.end())
+            data->remap[pin] = previous->second;
+    }
+    // Composite port outputs are found through the pin they show
+    for (const auto &alias: net.aliases)
+        pinsOf[alias.first->id] = alias.second;
+    sentPins = std::move(pinsOf);
+    data->traced = sentConnectors(net, tracedIds);
+    data->waved = sentConnectors(net, wavedIds);
+    for (const BreakpointSpec &spec: breakpointSpecs)
+        data->breakpoints.push_back(BreakpointData{spec.expression, spec.names, sentConnectors(net, spec.ids)});
+
+    Command command{CommandType::LOAD};
+    command.load = std::move(data);
+    send(std::move(command));
+    return version;
+}
+
+std::vector<const Connector *> SimulationThread::sentConnectors(const Netlist &net,
+                                                              const std::vector<uint64_t> &ids) const {
+    std::vector<const Connector *> connectors;
+    for (uint64_t id: ids) {
+        auto pin = sentPins.find(id);
+        const Connector *c = pin != sentPins.end() ? net.connectors[pin->second] : nullptr;
+        // Composite port outputs share the pin they show
+        if (c && c->id != id)
+            c = nullptr;
+        if (!c && pin != sentPins.end())
+            for (const auto &alias: net.aliases)
+                if (alias.first->id == id)
+                    c = alias.first;
+        connectors.push_back(c);
+    }
+    return connectors;
+}
+
+void SimulationThread::setPin(uint32_t pin, bool value) {
+    send(Command{CommandType::SET_PIN, ((uint64_t) pin << 1) | value});
+}
+
+void SimulationThread::setMode(EngineMode mode) {
+    send(Command{CommandType::SET_MODE, (uint64_t) mode});
+}
+
+void SimulationThread::setThreadCount(uint32_t n) {
+    send(Command{CommandType::SET_THREADS, n});
+}
+
+void SimulationThread::setTickRate(double ticksPerSecond) {
+    Command command{CommandType::SET_RATE};
+    command.rate = ticksPerSecond;
+    send(std::move(command));
+}
+
+void SimulationThread::setTickMode(TickMode mode) {
+    send(Command{CommandType::SET_TICK_MODE, (uint64_t) mode});
+}
+
+void SimulationThread::setCycleDetection(bool enabled) {
+    send(Command{CommandType::SET_CYCLE_DETECTION, enabled});
+}
+
+void SimulationThread::setHistoryBudget(size_t bytes) {
+    send(Command{CommandType::SET_HISTORY, bytes});
+}
+
+void SimulationThread::seek(uint64_t tick) {
+    send(Command{CommandType::SEEK, tick});
+}
+
+void SimulationThread::rewind(uint64_t ticks) {
+    send(Command{CommandType::REWIND, ticks});
+}
+
+void SimulationThread::setPaused(bool p) {
+    send(Command{CommandType::PAUSE, p});
+}
+
+bool SimulationThread::startTrace(const string &path, const std::vector<Probe> &probes) {
+    stopTrace();
+    std::vector<string> names;
+    Command command{CommandType::START_TRACE};
+    for (const Probe &probe: probes) {
+        names.push_back(probe.name);
+        tracedIds.push_back(probe.connector->id);
+        // Only connectors of the netlist the simulation thread has can be matched there
+        command.traced.push_back(sentPins.count(probe.connector->id) ? probe.connector : nullptr);
+    }
+    bool vcd = path.size() >= 4 && path.compare(path.size() - 4, 4, ".vcd") == 0;
+    if (vcd)
+        command.trace = std::make_unique<VcdWriter>();
+    else
+        command.trace = std::make_unique<TraceFileWriter>();
+    if (probes.empty() || !command.trace->open(path, names)) {
+        tracedIds.clear();
+        return false;
+    }
+    send(std::move(command));
+    return true;
+}
+
+void SimulationThread::stopTrace() {
+    if (tracedIds.empty())
+        return;
+    tracedIds.clear();
+    send(Command{CommandType::STOP_TRACE});
+}
+
+void SimulationThread::showWaveforms(const std::vector<Probe> &probes) {
+    Command command{CommandType::START_WAVEFORMS};
+    wavedIds.clear();
+    for (const Probe &probe: probes) {
+        command.names.push_back(probe.name);
+        wavedIds.push_back(probe.connector->id);
+        command.traced.push_back(sentPins.count(probe.connector->id) ? probe.connector : nullptr);
+    }
+    send(std::move(command));
+}
+
+void SimulationThread::hideWaveforms() {
+    if (wavedIds.empty())
+        return;
+    wavedIds.clear();
+    send(Command{CommandType::STOP_WAVEFORMS});
+}
+
+bool SimulationThread::addBreakpoint(const string &expression, const std::vector<Probe> &probes) {
+    BreakpointSpec spec{expression};
+    Command command{CommandType::ADD_BREAKPOINT};
+    for (const Probe &probe: probes) {
+        spec.names.push_back(probe.name);
+        spec.ids.push_back(probe.connector->id);
+        command.traced.push_back(sentPins.count(probe.connector->id) ? probe.connector : nullptr);
+    }
+    // Compiled here too so errors show up on the editor side
+    Breakpoint check;
+    if (!check.compile(expression, spec.names))
+        return false;
+    command.expression = expression;
+    command.names = spec.names;
+    breakpointSpecs.push_back(std::move(spec));
+    send(std::move(command));
+    return true;
+}
+
+void SimulationThread::clearBreakpoints() {
+    breakpointSpecs.clear();
+    send(Command{CommandType::CLEAR_BREAKPOINTS});
+}
+
+void SimulationThread::advance(uint64_t ticks) {
+    send(Command{CommandType::ADVANCE, ticks});
+}
+
+void SimulationThread::runJob(std::function<void()> job) {
+    Command command{CommandType::JOB};
+    command.job = std::move(job);
+    send(std::move(command));
+}
+
+void SimulationThread::apply(Command &command) {
+    switch (command.type) {
+        case CommandType::LOAD: {
+            LoadData &data = *command.load;
+            std::vector<uint8_t> previous;
+            simulator.readPins(previous);
+            for (uint32_t pin = 0; pin < data.remap.size(); pin++)
+                if (data.remap[pin] != NO_PIN && data.remap[pin] < previous.size())
+                    data.state[pin] = previous[data.remap[pin]];
+            simulator.load(std::move(data.netlist), data.state);
+            if (trace)
+                simulator.attachTrace(trace.get(), data.traced);
+            if (waveforms.isOpen())
+                simulator.attachTrace(&waveforms, data.waved);
+            // Connectors of the previous netlist are gone, breakpoints start over on the new ones
+            simulator.clearBreakpoints();
+            breakpoints.clear();
+            for (const BreakpointData &b: data.breakpoints)
+                breakpoints[simulator.addBreakpoint(b.expression, b.names, b.probes)] = b.expression;
+            loadedVersion = data.version;
+            publish();
+        } break;
+        case CommandType::SET_PIN:
+            simulator.setLoadedPin((uint32_t) (command.value >> 1), command.value & 1);
+            break;
+        case CommandType::SET_MODE:
+            simulator.setMode((EngineMode) command.value);
+            break;
+        case CommandType::SET_THREADS:
+            simulator.setThreadCount((uint32_t) command.value);
+            break;
+        case CommandType::SET_RATE:
+            scheduler.setRate(command.rate);
+            break;
+        case CommandType::SET_TICK_MODE:
+            scheduler.setMode((TickMode) command.value);
+            break;
+        case CommandType::SET_CYCLE_DETECTION:
+            simulator.setCycleDetection(command.value);
+            break;
+        case CommandType::SET_HISTORY:
+            simulator.setHistoryBudget(command.value);
+            break;
+        case CommandType::START_TRACE:
+            finishTick();
+            if (trace)
+                simulator.detachTrace(trace.get());
+            trace = std::move(command.trace);
+            simulator.attachTrace(trace.get(), command.traced);
+            break;
+        case CommandType::STOP_TRACE:
+            if (trace)
+                simulator.detachTrace(trace.get());
+            trace.reset(); // closes the file once the writer caught up
+            break;
+        case CommandType::START_WAVEFORMS:
+            finishTick();
+            simulator.detachTrace(&waveforms);
+            waveforms.open("", command.names);
+            simulator.attachTrace(&waveforms, command.traced);
+            break;
+        case CommandType::STOP_WAVEFORMS:
+            simulator.detachTrace(&waveforms);
+            waveforms.close();
+            break;
+        case CommandType::ADD_BREAKPOINT: {
+            finishTick();
+            int id = simulator.addBreakpoint(command.expression, command.names, command.traced);
+            if (id >= 0)
+                breakpoints[id] = command.expression;
+        } break;
+        case CommandType::CLEAR_BREAKPOINTS:
+            simulator.clearBreakpoints();
+            breakpoints.clear();
+            breakpointHit.clear();
+            break;
+        case CommandType::SEEK:
+            seekTo(command.value);
+            break;
+        case CommandType::REWIND:
+            finishTick();
+            seekTo(simulator.getTick() - std::min(command.value, simulator.getTick()));
+            break;
+        case CommandType::PAUSE:
+            finishTick();
+            paused = command.value;
+            if (!paused)
+                breakpointHit.clear();
+            scheduler.restart();
+            publish();
+            break;
+        case CommandType::ADVANCE: {
+            auto start = Clock::now();
+            finishTick();
+            uint64_t first = simulator.getTick();
+            breakpointHit.clear();
+            // Jumps ahead through the lookahead engine, the ticks in between are not recorded
+            simulator.runTicks(command.value, false);
+            checkBreakpoint();
+            advancedTicks = simulator.getTick() - first;
+            advanceSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+            scheduler.restart();
+            publish();
+        } break;
+        case CommandType::JOB:
+            command.job();
+            // The ticks missed meanwhile are not caught up
+            scheduler.restart();
+            break;
+        case CommandType::STOP:
+            running = false;
+            break;
+    }
+}
+
+void SimulationThread::finishTick() {
+    if (midTick) {
+        simulator.endUpdate();
+        midTick = false;
+        checkBreakpoint();
+    }
+}
+
+void SimulationThread::checkBreakpoint() {
+    int hit = simulator.getBreakpointHit();
+    if (hit < 0)
+        return;
+    paused = true;
+    breakpointHit = breakpoints[hit];
+}
+
+void SimulationThread::seekTo(uint64_t tick) {
+    finishTick();
+    const StateHistory &history = simulator.getHistory();
+    if (!history.empty())
+        simulator.seek(std::min(std::max(tick, history.getFirstTick()), history.getLastTick()));
+    paused = true;
+    publish();
+}
+
+void SimulationThread::publish() {
+    SimulationSnapshot &snapshot = snapshots.back();
+    simulator.readPins(snapshot.pins);
+    snapshot.version = loadedVersion;
+    snapshot.tick = simulator.getTick();
+    snapshot.midTick = midTick;
+    snapshot.tickStart = tickStart;
+    snapshot.tickPeriod = std::chrono::duration_cast<std::chrono::nanoseconds>(scheduler.getPeriod());
+    snapshot.ticksPerSecond = scheduler.getAchievedRate();
+    snapshot.droppedTicks = scheduler.getDroppedTicks();
+    snapshot.advancedTicks = advancedTicks;
+    snapshot.advanceSeconds = advanceSeconds;
+    snapshot.cycleStatus = simulator.getCycleDetector().getStatus();
+    snapshot.period = simulator.getCycleDetector().getPeriod();
+    snapshot.paused = paused;
+    snapshot.historyFirst = simulator.getHistory().getFirstTick();
+    snapshot.historyLast = simulator.getHistory().getLastTick();
+    snapshot.historyBytes = simulator.getHistory().getMemoryUsage();
+    snapshot.tracedChanges = trace ? trace->getChangeCount() : 0;
+    snapshot.breakpoint = breakpointHit;
+    snapshots.publish();
+    lastPublish = Clock::now();
+    if (trace)
+        trace->flush();
+    if (waveforms.isOpen())
+        waveforms.flush();
+}
+
+void SimulationThread::run() {
+    while (running) {
+        Command command;
+        while (commands.pop(command))
+            apply(command);
+        if (!running)
+            break;
+        if (loadedVersion == 0 || paused) {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait(lock, [this] { return !commands.empty(); });
+            continue;
+        }
+        step();
+    }
+}
+
+void SimulationThread::step() {
+    auto now = Clock::now();
+    TickScheduler::Step next = scheduler.next(now);
+    bool animated = scheduler.getMode() != TickMode::TURBO && scheduler.getPeriod() >= PUBLISH_PERIOD;
+
+    if (next.ticks) {
+        finishTick(); // the tick left open by the previous step ends now
+        if (!paused) {
+            simulator.runTicks(animated ? next.ticks - 1 : next.ticks);
+            checkBreakpoint();
+        }
+        if (paused)
+            publish(); // stopped by a breakpoint
+        else if (animated) {
+            // The last tick stays open until the next step so its links can be drawn moving
+            simulator.beginUpdate();
+            midTick = true;
+            tickStart = next.start;
+            publish();
+        }
+    }
+    auto end = Clock::now();
+    scheduler.ticked(next.ticks, end - now, end);
+    if (!animated && end - lastPublish >= PUBLISH_PERIOD)
+        publish();
+
+    if (next.wakeUp > end) {
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        wake.wait_until(lock, next.wakeUp, [this] { return !commands.empty(); });
+    }
+}
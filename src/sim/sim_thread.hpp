@@ -0,0 +1,240 @@
+// Runs a Simulator on its own thread so ticks never wait on rendering.
+//
+// The editor keeps the authoring model (Circuit) and a front Simulator used as a compiler. Every command goes
+// through a lock-free queue : after an edit the editor sends the new netlist with a pin remap, so pins whose
+// connector still exists keep the state the simulation thread reached. States come back as a triple-buffered
+// snapshot the renderer reads whenever it wants.
+
+#pragma once
+
+#include "simulator.hpp"
+#include "spsc_queue.hpp"
+#include "tick_scheduler.hpp"
+#include "trace_file.hpp"
+#include "triple_buffer.hpp"
+#include "vcd_writer.hpp"
+#include "waveform.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct SimulationSnapshot {
+    std::vector<uint8_t> pins; // layout of the netlist sent with `version`
+    uint64_t version = 0;
+    uint64_t tick = 0;
+    bool midTick = false; // taken between beginUpdate & endUpdate, links are moving
+    std::chrono::steady_clock::time_point tickStart;
+    std::chrono::nanoseconds tickPeriod{0};
+    double ticksPerSecond = 0; // achieved
+    uint64_t droppedTicks = 0; // scheduled ticks skipped because the simulation was late
+    uint64_t advancedTicks = 0; // last advance()
+    double advanceSeconds = 0;
+    CycleStatus cycleStatus = CycleStatus::SEARCHING; // only meaningful with cycle detection on
+    uint64_t period = 0;
+    bool paused = false;
+    uint64_t historyFirst = 0; // recorded ticks, seek() targets
+    uint64_t historyLast = 0;
+    size_t historyBytes = 0;
+    uint64_t tracedChanges = 0; // written to the VCD trace
+    string breakpoint; // expression that paused the simulation, empty when none did
+};
+
+class SimulationThread {
+public:
+    SimulationThread();
+
+    ~SimulationThread();
+
+    SimulationThread(const SimulationThread &) = delete;
+
+    SimulationThread &operator=(const SimulationThread &) = delete;
+
+    // ---- Editor thread only ----
+
+    // Send the netlist & pins of `front`. Connectors seen in the previous load keep their simulated state,
+    // except the ones listed in `edits`. Returns the version snapshots of this netlist will carry.
+    uint64_t load(const Simulator &front, const StateEdits &edits);
+
+    uint64_t getVersion() const { return version; }
+
+    // Pin of the last loaded netlist.
+    void setPin(uint32_t pin, bool value);
+
+    void setMode(EngineMode mode);
+
+    void setThreadCount(uint32_t n);
+
+    // Target rate of the FIXED & CATCH_UP modes.
+    void setTickRate(double ticksPerSecond);
+
+    void setTickMode(TickMode mode);
+
+    // See Simulator::setCycleDetection, found periods show up in snapshots.
+    void setCycleDetection(bool enabled);
+
+    // Memory kept for stepping back, 0 stops recording.
+    void setHistoryBudget(size_t bytes);
+
+    // Pause on a recorded tick, clamped to the recorded range. Resuming ticks from there.
+    void seek(uint64_t tick);
+
+    // seek() relative to the current tick.
+    void rewind(uint64_t ticks);
+
+    void setPaused(bool paused);
+
+    // Write the value changes of `probes` from now on until stopTrace(), as VCD when `path` ends with .vcd and as a
+    // native binary trace (see sim/trace_file.hpp) otherwise.
+    bool startTrace(const string &path, const std::vector<Probe> &probes);
+
+    void stopTrace();
+
+    bool isTracing() const { return !tracedIds.empty(); }
+
+    // Record `probes` into getWaveforms() from now on, starting over.
+    void showWaveforms(const std::vector<Probe> &probes);
+
+    // Stop recording, the waveforms recorded so far stay readable.
+    void hideWaveforms();
+
+    bool isShowingWaveforms() const { return !wavedIds.empty(); }
+
+    // Readable from any thread.
+    const WaveformRecorder &getWaveforms() const { return waveforms; }
+
+    // Pause right after the tick `expression` becomes true, see sim/breakpoint.hpp. It reads the signals of `probes`
+    // by name. False (logged) when it doesn't compile.
+    bool addBreakpoint(const string &expression, const std::vector<Probe> &probes);
+
+    void clearBreakpoints();
+
+    size_t getBreakpointCount() const { return breakpointSpecs.size(); }
+
+    // Run `ticks` ticks at once, without pacing nor intermediate snapshots, then resume the schedule. On several
+    // threads the ticks run as one lookahead batch, recorded history then starts over after it.
+    void advance(uint64_t ticks);
+
+    // Run `job` on the simulation thread between two ticks, which wait for it. For editor commands too long to run
+    // within a frame, the job logs its own result.
+    void runJob(std::function<void()> job);
+
+    // Swap in the latest snapshot, false when nothing new was published.
+    bool updateSnapshot() { return snapshots.update(); }
+
+    const SimulationSnapshot &getSnapshot() const { return snapshots.front(); }
+
+private:
+    enum class CommandType {
+        LOAD,
+        SET_PIN,
+        SET_MODE,
+        SET_THREADS,
+        SET_RATE,
+        SET_TICK_MODE,
+        SET_CYCLE_DETECTION,
+        SET_HISTORY,
+        START_TRACE,
+        STOP_TRACE,
+        START_WAVEFORMS,
+        STOP_WAVEFORMS,
+        ADD_BREAKPOINT,
+        CLEAR_BREAKPOINTS,
+        SEEK,
+        REWIND,
+        PAUSE,
+        ADVANCE,
+        JOB,
+        STOP
+    };
+
+    struct BreakpointData {
+        string expression;
+        std::vector<string> names;
+        std::vector<const Connector *> probes; // per name, nullptr when not in the netlist
+    };
+
+    struct LoadData {
+        Netlist netlist;
+        std::vector<uint8_t> state;
+        std::vector<uint32_t> remap; // new pin -> previous pin, NO_PIN takes `state`
+        std::vector<const Connector *> traced; // per trace signal, nullptr when not in the netlist
+        std::vector<const Connector *> waved;  // per waveform signal
+        std::vector<BreakpointData> breakpoints;
+        uint64_t version;
+    };
+
+    struct Command {
+        CommandType type = CommandType::STOP;
+        uint64_t value = 0;
+        double rate = 0;
+        std::unique_ptr<LoadData> load;
+        std::unique_ptr<TraceWriter> trace;
+        std::function<void()> job;
+        std::vector<const Connector *> traced;
+        std::vector<string> names;
+        string expression;
+    };
+
+    static constexpr uint32_t NO_PIN = UINT32_MAX;
+
+    // Editor side
+    uint64_t version = 0;
+    std::unordered_map<uint64_t, uint32_t> sentPins; // connector id -> pin of the last load
+    std::vector<uint64_t> tracedIds;                  // connector id per trace signal
+    std::vector<uint64_t> wavedIds;
+    struct BreakpointSpec {
+        string expression;
+        std::vector<string> names;
+        std::vector<uint64_t> ids; // connector id per name
+    };
+    std::vector<BreakpointSpec> breakpointSpecs;
+
+    // Shared
+    SpscQueue<Command> commands{1024};
+    TripleBuffer<SimulationSnapshot> snapshots;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+
+    // Simulation thread side
+    Simulator simulator;
+    uint64_t loadedVersion = 0;
+    bool running = true;
+    bool midTick = false;
+    bool paused = false;
+    TickScheduler scheduler;
+    std::chrono::steady_clock::time_point tickStart;
+    std::chrono::steady_clock::time_point lastPublish;
+    uint64_t advancedTicks = 0;
+    double advanceSeconds = 0;
+    std::unique_ptr<TraceWriter> trace;
+    WaveformRecorder waveforms;
+    std::unordered_map<int, string> breakpoints; // simulator id -> expression
+    string breakpointHit;
+    std::thread thread;
+
+    void send(Command &&command);
+
+    // Connectors of the last load for these ids, nullptr for the ones it doesn't have.
+    std::vector<const Connector *> sentConnectors(const Netlist &net, const std::vector<uint64_t> &ids) const;
+
+    void apply(Command &command);
+
+    void publish();
+
+    // Close a tick left open for animation.
+    void finishTick();
+
+    // Pause when the last tick fired a breakpoint.
+    void checkBreakpoint();
+
+    void seekTo(uint64_t tick);
+
+    void step();
+
+    void run();
+};
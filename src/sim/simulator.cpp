@@ -0,0 +1,388 @@
+#include "simulator.hpp"
+#include "node/composite.hpp"
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+
+Simulator::Simulator() {
+    netlist.partition(1);
+    buildSlices();
+}
+
+Simulator::~Simulator() = default;
+
+void Simulator::load(const Circuit &circuit) {
+    Netlist net = Netlist::compile(circuit);
+    std::vector<uint8_t> state(net.pinCount);
+    for (uint32_t i = 0; i < net.pinCount; i++)
+        if (net.connectors[i])
+            state[i] = net.connectors[i]->state;
+    for (size_t i = 0; i < net.instances.size(); i++)
+        for (uint32_t k = net.instanceStart[i]; k < net.instanceStart[i + 1]; k++)
+            state[net.instancePins[k]] = net.instances[i]->states[k - net.instanceStart[i]];
+    std::vector<const Connector *> observed;
+    for (const Probe &probe: circuit.getProbes())
+        observed.push_back(probe.connector);
+    optimizedForSettle = mode == EngineMode::SETTLE;
+    optimizeReport = optimizeNetlist(net, state, optimization, optimizedForSettle, observed);
+    optimizationChanged = false;
+    load(std::move(net), state);
+}
+
+void Simulator::load(Netlist net, const std::vector<uint8_t> &state) {
+    netlist = std::move(net);
+    loadedPins.resize(netlist.pinCount);
+    std::iota(loadedPins.begin(), loadedPins.end(), 0);
+    if (getThreadCount() > 1)
+        loadedPins = netlist.partition(getThreadCount());
+    pins.assign(netlist.pinCount + PIN_PADDING, 0);
+    for (uint32_t i = 0; i < netlist.pinCount; i++)
+        pins[loadedPins[i]] = state[i];
+    buildEngine();
+    buildSlices();
+    cycles.reset();
+    restartHistory();
+    for (TraceTap &tap: traces)
+        tap.connectors.clear();
+    for (BreakpointTap &tap: breakpoints)
+        std::fill(tap.connectors.begin(), tap.connectors.end(), nullptr);
+    resolveProbes();
+}
+
+void Simulator::readPins(std::vector<uint8_t> &state) const {
+    state.resize(loadedPins.size());
+    for (size_t i = 0; i < loadedPins.size(); i++)
+        state[i] = pins[loadedPins[i]];
+}
+
+void Simulator::writePins(const std::vector<uint8_t> &state) {
+    for (size_t i = 0; i < loadedPins.size() && i < state.size(); i++)
+        pins[loadedPins[i]] = state[i];
+    if (mode == EngineMode::EVENT)
+        events.scheduleAll();
+    cycles.reset();
+    armBreakpoints();
+}
+
+void Simulator::setCycleDetection(bool enabled) {
+    detectCycles = enabled;
+    cycles.reset();
+}
+
+void Simulator::setHistoryBudget(size_t bytes) {
+    history.setBudget(bytes);
+    if (history.empty())
+        restartHistory();
+}
+
+// Pins change layout when loading & partitioning, start over from the current state
+void Simulator::restartHistory() {
+    history.clear();
+    history.record(pins.data(), netlist.pinCount, tickCount);
+    for (TraceTap &tap: traces)
+        tap.writer->sample(tickCount, pins.data(), tap.pins.data());
+}
+
+bool Simulator::seek(uint64_t tick) {
+    if (!history.restore(tick, pins.data(), netlist.pinCount))
+        return false;
+    tickCount = tick;
+    if (mode == EngineMode::EVENT)
+        events.scheduleAll();
+    cycles.reset();
+    armBreakpoints();
+    return true;
+}
+
+void Simulator::attachTrace(TraceWriter *writer, const std::vector<const Connector *> &probes) {
+    detachTrace(writer);
+    traces.push_back(TraceTap{writer, probes, {}});
+    resolveProbes();
+    writer->sample(tickCount, pins.data(), traces.back().pins.data());
+}
+
+void Simulator::detachTrace(TraceWriter *writer) {
+    traces.erase(std::remove_if(traces.begin(), traces.end(), [writer](const TraceTap &tap) {
+        return tap.writer == writer;
+    }), traces.end());
+}
+
+int Simulator::addBreakpoint(const string &expression, const std::vector<string> &names,
+                             const std::vector<const Connector *> &probes) {
+    BreakpointTap tap{nextBreakpointId, {}, {}};
+    if (!tap.breakpoint.compile(expression, names))
+        return -1;
+    for (uint32_t signal: tap.breakpoint.getSignals())
+        tap.connectors.push_back(signal < probes.size() ? probes[signal] : nullptr);
+    breakpoints.push_back(std::move(tap));
+    resolveProbes();
+    return nextBreakpointId++;
+}
+
+void Simulator::removeBreakpoint(int id) {
+    breakpoints.erase(std::remove_if(breakpoints.begin(), breakpoints.end(), [id](const BreakpointTap &tap) {
+        return tap.id == id;
+    }), breakpoints.end());
+}
+
+void Simulator::clearBreakpoints() {
+    breakpoints.clear();
+    breakpointHit = -1;
+}
+
+void Simulator::armBreakpoints() {
+    for (BreakpointTap &tap: breakpoints)
+        tap.breakpoint.arm(pins.data());
+}
+
+void Simulator::resolveProbes() {
+    std::unordered_map<const Connector *, uint32_t> pinOf;
+    for (const TraceTap &tap: traces)
+        for (const Connector *c: tap.connectors)
+            pinOf[c] = TraceWriter::NO_PIN;
+    for (const BreakpointTap &tap: breakpoints)
+        for (const Connector *c: tap.connectors)
+            pinOf[c] = TraceWriter::NO_PIN;
+    for (uint32_t pin = 0; pin < netlist.pinCount && !pinOf.empty(); pin++) {
+        auto it = pinOf.find(netlist.connectors[pin]);
+        if (it != pinOf.end() && netlist.connectors[pin])
+            it->second = pin;
+    }
+    for (const auto &alias: netlist.aliases) {
+        auto it = pinOf.find(alias.first);
+        if (it != pinOf.end())
+            it->second = alias.second;
+    }
+    for (TraceTap &tap: traces) {
+        tap.pins.assign(tap.writer->getSignalCount(), TraceWriter::NO_PIN);
+        for (size_t i = 0; i < tap.connectors.size() && i < tap.pins.size(); i++)
+            tap.pins[i] = pinOf[tap.connectors[i]];
+    }
+    std::vector<uint32_t> signalPins;
+    for (BreakpointTap &tap: breakpoints) {
+        signalPins.clear();
+        for (const Connector *c: tap.connectors)
+            signalPins.push_back(c ? pinOf[c] : Breakpoint::NO_PIN);
+        tap.breakpoint.setPins(signalPins, pins.data());
+    }
+}
+
+// After every complete tick
+void Simulator::ticked() {
+    tickCount++;
+    if (detectCycles)
+        cycles.observe(pins.data(), netlist.pinCount, tickCount);
+    history.record(pins.data(), netlist.pinCount, tickCount);
+    for (TraceTap &tap: traces)
+        tap.writer->sample(tickCount, pins.data(), tap.pins.data());
+    breakpointHit = -1;
+    for (BreakpointTap &tap: breakpoints)
+        if (tap.breakpoint.check(pins.data()) && breakpointHit < 0)
+            breakpointHit = tap.id;
+}
+
+void Simulator::setLookahead(uint32_t ticks) {
+    lookahead = std::max(ticks, 1u);
+    pdesReady = false;
+}
+
+void Simulator::setLutInputs(uint32_t n) {
+    settler.setMaxLutInputs(n);
+    buildEngine();
+}
+
+void Simulator::setOptimization(const OptimizeOptions &options) {
+    optimization = options;
+    optimizationChanged = true;
+}
+
+bool Simulator::needsReload() const {
+    return optimizationChanged || (optimization.notPairs && optimizedForSettle != (mode == EngineMode::SETTLE));
+}
+
+void Simulator::buildEngine() {
+    if (mode == EngineMode::EVENT)
+        events.build(netlist);
+    else if (mode == EngineMode::SETTLE)
+        settler.build(netlist);
+}
+
+void Simulator::setMode(EngineMode m) {
+    if (m == mode)
+        return;
+    mode = m;
+    buildEngine();
+    cycles.reset();
+}
+
+void Simulator::setThreadCount(uint32_t n) {
+    if (n == 0)
+        n = ThreadPool::getHardwareThreads();
+    if (n == getThreadCount())
+        return;
+    pool = n > 1 ? std::make_unique<ThreadPool>(n) : nullptr;
+    barrier.reset(n);
+
+    // Re-partition for the new thread count, pins move with their gates & links
+    std::vector<uint32_t> pinMap = netlist.partition(n);
+    std::vector<uint8_t> moved(pins.size(), 0);
+    for (uint32_t pin = 0; pin < netlist.pinCount; pin++)
+        moved[pinMap[pin]] = pins[pin];
+    pins = std::move(moved);
+    for (uint32_t &pin: loadedPins)
+        pin = pinMap[pin];
+    buildEngine();
+    buildSlices();
+    cycles.reset();
+    restartHistory();
+    resolveProbes();
+}
+
+void Simulator::runTicks(uint64_t n, bool record) {
+    breakpointHit = -1;
+    bool toggleCounts = std::any_of(breakpoints.begin(), breakpoints.end(), [](const BreakpointTap &tap) {
+        return tap.breakpoint.countsToggles();
+    });
+    if (detectCycles && traces.empty() && !toggleCounts) {
+        while (n && !cycles.isDetected()) {
+            tick();
+            n--;
+            if (breakpointHit >= 0)
+                return;
+        }
+        // Breakpoints see every state of the cycle within a period : quiet for one, quiet for all of them
+        for (uint64_t i = 0; n && !breakpoints.empty() && i < cycles.getPeriod(); i++) {
+            tick();
+            n--;
+            if (breakpointHit >= 0)
+                return;
+        }
+        // The state after k whole periods is the current one, recorded history starts over after the jump
+        uint64_t skip = n ? n - n % cycles.getPeriod() : 0;
+        tickCount += skip;
+        skippedTicks += skip;
+        n -= skip;
+    }
+    if (mode != EngineMode::FULL || !pool || n < 2 || (record && history.isEnabled()) || !traces.empty() ||
+        !breakpoints.empty()) {
+        for (uint64_t i = 0; i < n && breakpointHit < 0; i++)
+            tick();
+        return;
+    }
+    if (!pdesReady) {
+        pdes.build(netlist, lookahead);
+        pdesReady = true;
+    }
+    pdes.run(pins.data(), n, *pool, *kernels);
+    tickCount += n;
+    history.record(pins.data(), netlist.pinCount, tickCount);
+}
+
+// Each worker runs the partition of the same index, only links crossing partitions read another worker's pins.
+void Simulator::buildSlices() {
+    pdesReady = false;
+    slices.assign(netlist.partitionCount, WorkSlice{});
+    for (uint32_t k = 0; k < netlist.partitionCount; k++) {
+        for (int op = 0; op < (int) NodeOp::COUNT; op++) {
+            uint32_t first = netlist.opBegin(k, (NodeOp) op);
+            slices[k].gates[op] = Range{first, netlist.opEnd(k, (NodeOp) op) - first};
+        }
+        uint32_t first = netlist.linkPartStart[k];
+        slices[k].links = Range{netlist.linkBase + first, netlist.linkPartStart[k + 1] - first};
+    }
+}
+
+void Simulator::setPin(uint32_t pin, bool value) {
+    if (pins[pin] == value)
+        return;
+    pins[pin] = value;
+    if (mode == EngineMode::EVENT)
+        events.pinChanged(pin);
+    cycles.reset();
+    armBreakpoints();
+}
+
+uint32_t Simulator::getLastActivity() const {
+    return mode == EngineMode::EVENT ? events.getLastActivity() : netlist.gateCount;
+}
+
+void Simulator::store() {
+    for (uint32_t i = 0; i < netlist.pinCount; i++)
+        if (netlist.connectors[i])
+            netlist.connectors[i]->state = pins[i];
+    for (size_t i = 0; i < netlist.instances.size(); i++) {
+        std::vector<bool> &states = netlist.instances[i]->states;
+        for (uint32_t k = netlist.instanceStart[i]; k < netlist.instanceStart[i + 1]; k++)
+            states[k - netlist.instanceStart[i]] = pins[netlist.instancePins[k]];
+    }
+    for (const auto &alias: netlist.aliases)
+        alias.first->state = pins[alias.second];
+    for (size_t i = 0; i < netlist.linkObjects.size(); i++) {
+        Link *link = netlist.linkObjects[i];
+        link->nextState = pins[netlist.linkObjectPins[2 * i]];
+        link->state = pins[netlist.linkObjectPins[2 * i + 1]];
+    }
+}
+
+void Simulator::updateGates(const WorkSlice &slice) {
+    uint8_t *p = pins.data();
+    const uint32_t *in = netlist.inputPins.data();
+    auto run = [&](auto kernel, NodeOp op) {
+        const Range &r = slice.gates[(int) op];
+        if (r.count)
+            kernel(p, in + netlist.inputStart[r.first], r.first, r.count);
+    };
+    run(kernels->notGates, NodeOp::NOT);
+    run(kernels->andGates, NodeOp::AND);
+    run(kernels->orGates, NodeOp::OR);
+    run(kernels->xorGates, NodeOp::XOR);
+}
+
+void Simulator::updateLinks(const WorkSlice &slice) {
+    const Range &r = slice.links;
+    if (r.count)
+        kernels->copyLinks(pins.data(), netlist.linkSrc.data() + (r.first - netlist.linkBase), r.first, r.count);
+}
+
+void Simulator::tick() {
+    if (mode != EngineMode::FULL || !pool) {
+        beginUpdate();
+        endUpdate();
+        return;
+    }
+    // Gates only read input pins and links only read gate outputs & sources : one barrier between them
+    pool->run([this](uint32_t worker) {
+        updateGates(slices[worker]);
+        barrier.wait();
+        updateLinks(slices[worker]);
+    });
+    ticked();
+}
+
+void Simulator::beginUpdate() {
+    if (mode == EngineMode::EVENT) {
+        events.beginUpdate(pins.data());
+        return;
+    }
+    if (mode == EngineMode::SETTLE) {
+        settler.settle(pins.data());
+        return;
+    }
+    if (pool)
+        pool->run([this](uint32_t worker) { updateGates(slices[worker]); });
+    else
+        updateGates(slices[0]);
+}
+
+void Simulator::endUpdate() {
+    if (mode == EngineMode::EVENT)
+        events.endUpdate(pins.data());
+    else if (mode == EngineMode::FULL) {
+        if (pool)
+            pool->run([this](uint32_t worker) { updateLinks(slices[worker]); });
+        else
+            updateLinks(slices[0]);
+    }
+    // SETTLE copied links while settling
+    ticked();
+}
@@ -0,0 +1,220 @@
+// Runs ticks on a compiled netlist.
+
+#pragma once
+
+#include "breakpoint.hpp"
+#include "cycle_detector.hpp"
+#include "event_engine.hpp"
+#include "history.hpp"
+#include "kernels.hpp"
+#include "netlist.hpp"
+#include "optimizer.hpp"
+#include "pdes_engine.hpp"
+#include "settle_engine.hpp"
+#include "thread_pool.hpp"
+#include "trace_writer.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+enum class EngineMode {
+    FULL,  // every gate & link each tick, SIMD kernels
+    EVENT, // only what changed during the previous tick
+    SETTLE // zero delay links, every tick settles the whole circuit
+};
+
+class Simulator {
+public:
+    Simulator();
+
+    ~Simulator();
+
+    // Compile & optimize the circuit and capture its connectors states. The dead sweep keeps the probes.
+    void load(const Circuit &circuit);
+
+    // Take over a netlist compiled elsewhere, `state` holds one byte per pin of that netlist.
+    void load(Netlist net, const std::vector<uint8_t> &state);
+
+    // Pins in the layout of the loaded netlist, which partitioning for several threads reorders.
+    void readPins(std::vector<uint8_t> &state) const;
+
+    void writePins(const std::vector<uint8_t> &state);
+
+    // Write pins back into the connectors, instances & links of the circuit the netlist was compiled from.
+    void store();
+
+    // Evaluate every gate (Node::update + Link::fetchNextState).
+    void beginUpdate();
+
+    // Copy outputs through links (Link::propagate).
+    void endUpdate();
+
+    // beginUpdate + endUpdate, in a single dispatch when running on several threads.
+    void tick();
+
+    // Run `n` ticks, fewer when a breakpoint fires. FULL ticks on several threads let partitions drift apart (see
+    // sim/pdes_engine.hpp) instead of meeting at a barrier every tick. Once the cycle detector found a period, whole
+    // periods are skipped. Recorded history makes it tick one at a time unless `record` is false : a batch then only
+    // records the state it ends on, history starting over from there.
+    void runTicks(uint64_t n, bool record = true);
+
+    uint64_t getTick() const { return tickCount; }
+
+    void setMode(EngineMode mode);
+
+    EngineMode getMode() const { return mode; }
+
+    // Write a pin from outside the engine (circuit inputs for example).
+    void setPin(uint32_t pin, bool value);
+
+    // setPin() for a pin in the layout of the loaded netlist, like readPins() & writePins().
+    void setLoadedPin(uint32_t pin, bool value) { setPin(loadedPins[pin], value); }
+
+    // Gates evaluated by the last beginUpdate.
+    uint32_t getLastActivity() const;
+
+    const SettleEngine &getSettleEngine() const { return settler; }
+
+    // Composite instances reading at most `n` pins settle through one lookup table, 0 evaluates every gate.
+    void setLutInputs(uint32_t n);
+
+    // Passes run by load(const Circuit &), see sim/optimizer.hpp. Takes effect at the next load.
+    void setOptimization(const OptimizeOptions &options);
+
+    const OptimizeOptions &getOptimization() const { return optimization; }
+
+    // What the passes removed during the last load(const Circuit &).
+    const OptimizeReport &getOptimizeReport() const { return optimizeReport; }
+
+    // The loaded netlist no longer matches the optimization options or the mode (see Netlist::zeroDelay).
+    bool needsReload() const;
+
+    const Netlist &getNetlist() const { return netlist; }
+
+    // One byte per pin (0 or 1), followed by PIN_PADDING unused bytes.
+    const std::vector<uint8_t> &getPins() const { return pins; }
+
+    // Threads running FULL ticks, the caller included. 0 uses every hardware thread.
+    void setThreadCount(uint32_t n);
+
+    uint32_t getThreadCount() const { return pool ? pool->getThreadCount() : 1; }
+
+    // Ticks a partition may run ahead of its neighbors in runTicks().
+    void setLookahead(uint32_t ticks);
+
+    uint32_t getLookahead() const { return lookahead; }
+
+    // Partition waits during the last runTicks().
+    uint64_t getStallCount() const { return pdes.getStallCount(); }
+
+    // Hash the state after every tick to find fixed points & periodic orbits. Searching ticks one at a time.
+    void setCycleDetection(bool enabled);
+
+    bool getCycleDetection() const { return detectCycles; }
+
+    const CycleDetector &getCycleDetector() const { return cycles; }
+
+    // Ticks counted but not computed because they only repeated a known period.
+    uint64_t getSkippedTicks() const { return skippedTicks; }
+
+    // Record recent states within `bytes` of memory (0 stops), see sim/history.hpp. Recording ticks one at a time.
+    void setHistoryBudget(size_t bytes);
+
+    const StateHistory &getHistory() const { return history; }
+
+    // Go back (or forward again) to a recorded tick, ticking from there forgets the recorded ticks after it.
+    bool seek(uint64_t tick);
+
+    // Sample the probed connectors into `writer` (VCD, .bbt, waveforms...) after every tick, attaching it again
+    // replaces its connectors. Connectors are matched by address against the loaded netlist, loading another one
+    // clears them. Tracing ticks one at a time.
+    void attachTrace(TraceWriter *writer, const std::vector<const Connector *> &probes);
+
+    void detachTrace(TraceWriter *writer);
+
+    // Stop runTicks() right after the tick `expression` becomes true, see sim/breakpoint.hpp. `probes` are the
+    // connectors `names` stand for, matched like trace connectors. Returns an id, -1 when it doesn't compile.
+    // Breakpoints tick one at a time, but keep skipping periods unless they count toggles.
+    int addBreakpoint(const string &expression, const std::vector<string> &names,
+                      const std::vector<const Connector *> &probes);
+
+    void removeBreakpoint(int id);
+
+    void clearBreakpoints();
+
+    bool hasBreakpoints() const { return !breakpoints.empty(); }
+
+    // Breakpoint fired by the last tick, -1 when none did.
+    int getBreakpointHit() const { return breakpointHit; }
+
+    void setKernels(const GateKernels &k) { kernels = &k; }
+
+    const GateKernels &getKernels() const { return *kernels; }
+
+private:
+    Netlist netlist;
+    std::vector<uint8_t> pins;
+    std::vector<uint32_t> loadedPins; // loaded netlist pin -> pin
+    const GateKernels *kernels = &selectGateKernels();
+    EngineMode mode = EngineMode::FULL;
+    OptimizeOptions optimization;
+    OptimizeReport optimizeReport;
+    bool optimizationChanged = false;
+    bool optimizedForSettle = false;
+    EventEngine events;
+    SettleEngine settler;
+    uint64_t tickCount = 0;
+    CycleDetector cycles;
+    bool detectCycles = false;
+    uint64_t skippedTicks = 0;
+    StateHistory history;
+    struct TraceTap {
+        TraceWriter *writer;
+        std::vector<const Connector *> connectors;
+        std::vector<uint32_t> pins; // per signal
+    };
+    std::vector<TraceTap> traces;
+    struct BreakpointTap {
+        int id;
+        Breakpoint breakpoint;
+        std::vector<const Connector *> connectors; // per watched signal
+    };
+    std::vector<BreakpointTap> breakpoints;
+    int nextBreakpointId = 0;
+    int breakpointHit = -1;
+
+    // Pins a worker owns, the same every tick.
+    struct Range {
+        uint32_t first;
+        uint32_t count;
+    };
+    struct WorkSlice {
+        Range gates[(int) NodeOp::COUNT];
+        Range links;
+    };
+
+    std::unique_ptr<ThreadPool> pool;
+    std::vector<WorkSlice> slices;
+    SpinBarrier barrier;
+    PdesEngine pdes;
+    uint32_t lookahead = 8;
+    bool pdesReady = false;
+
+    void buildEngine();
+
+    void ticked();
+
+    void restartHistory();
+
+    // Pins of the trace & breakpoint connectors in the loaded netlist.
+    void resolveProbes();
+
+    // Pins changed from outside the ticks, breakpoints take them as their reference.
+    void armBreakpoints();
+
+    void buildSlices();
+
+    void updateGates(const WorkSlice &slice);
+
+    void updateLinks(const WorkSlice &slice);
+};
@@ -0,0 +1,45 @@
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+template<typename T>
+class SpscQueue {
+public:
+    // Holds up to capacity - 1 items.
+    explicit SpscQueue(size_t capacity) : items(capacity) {}
+
+    // Producer side, false when the queue is full.
+    bool push(T &&item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        size_t next = (h + 1) % items.size();
+        if (next == tail.load(std::memory_order_acquire))
+            return false;
+        items[h] = std::move(item);
+        head.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side, false when the queue is empty.
+    bool pop(T &item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+            return false;
+        item = std::move(items[t]);
+        tail.store((t + 1) % items.size(), std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire);
+    }
+
+private:
+    std::vector<T> items;
+    alignas(64) std::atomic<size_t> head{0}; // next slot written
+    alignas(64) std::atomic<size_t> tail{0}; // next slot read
+};
@@ -0,0 +1,66 @@
+#include "thread_pool.hpp"
+
+// Wait iterations before an idle worker goes to sleep.
+static constexpr uint32_t SPIN_LIMIT = 1 << 14;
+
+ThreadPool::ThreadPool(uint32_t threads) {
+    for (uint32_t i = 1; i < threads; i++)
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        generation++;
+    }
+    wake.notify_all();
+    for (std::thread &t: workers)
+        t.join();
+}
+
+uint32_t ThreadPool::getHardwareThreads() {
+    uint32_t n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+void ThreadPool::dispatch(JobFn fn, void *ctx) {
+    if (workers.empty()) {
+        fn(ctx, 0);
+        return;
+    }
+    job = fn;
+    jobContext = ctx;
+    pending.store((uint32_t) workers.size(), std::memory_order_relaxed);
+    generation.fetch_add(1); // publishes the job
+    if (sleeping.load()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        wake.notify_all();
+    }
+    fn(ctx, 0);
+    spinWait([&] { return pending.load(std::memory_order_acquire) == 0; });
+}
+
+void ThreadPool::workerLoop(uint32_t worker) {
+    uint64_t seen = 0;
+    while (true) {
+        uint32_t spins = 0;
+        while (generation.load(std::memory_order_acquire) == seen && spins < SPIN_LIMIT) {
+            if (spins++ < 256)
+                cpuRelax();
+            else
+                std::this_thread::yield();
+        }
+        if (generation.load(std::memory_order_acquire) == seen) {
+            std::unique_lock<std::mutex> lock(mutex);
+            sleeping++;
+            wake.wait(lock, [&] { return generation.load() != seen; });
+            sleeping--;
+        }
+        seen = generation.load(std::memory_order_acquire);
+        if (stopping)
+            return;
+        job(jobContext, worker);
+        pending.fetch_sub(1, std::memory_order_release);
+    }
+}
@@ -0,0 +1,104 @@
+// Persistent workers for the tick loops.
+//
+// Threads are created once and spin between jobs, so dispatching a phase costs a couple of atomic operations
+// instead of an OpenMP fork/join. Workers that stay idle for a while fall asleep on a condition variable so an
+// idle editor does not burn every core.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+// Hint the CPU that we are busy waiting.
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// Busy wait until `done()`, yielding once in a while in case there are more threads than cores.
+template<typename Pred>
+inline void spinWait(Pred &&done) {
+    for (uint32_t spins = 0; !done(); spins++) {
+        if (spins < 256)
+            cpuRelax();
+        else
+            std::this_thread::yield();
+    }
+}
+
+// Sense reversing barrier, every one of the `count` threads must call wait() each phase.
+class SpinBarrier {
+public:
+    explicit SpinBarrier(uint32_t count = 1) : count(count), remaining(count) {}
+
+    void reset(uint32_t n) {
+        count = n;
+        remaining.store(n, std::memory_order_relaxed);
+    }
+
+    void wait() {
+        bool sense = this->sense.load(std::memory_order_relaxed);
+        if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            remaining.store(count, std::memory_order_relaxed);
+            this->sense.store(!sense, std::memory_order_release);
+            return;
+        }
+        spinWait([&] { return this->sense.load(std::memory_order_acquire) != sense; });
+    }
+
+private:
+    uint32_t count;
+    alignas(64) std::atomic<uint32_t> remaining;
+    alignas(64) std::atomic<bool> sense{false};
+};
+
+class ThreadPool {
+public:
+    // `threads` counts the calling thread, 1 means no worker at all.
+    explicit ThreadPool(uint32_t threads);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    uint32_t getThreadCount() const { return (uint32_t) workers.size() + 1; }
+
+    // Call job(worker) once for every worker index in [0, getThreadCount()), the caller being worker 0.
+    // Returns once every call returned.
+    template<typename Job>
+    void run(Job &&job) {
+        dispatch([](void *ctx, uint32_t worker) { (*(Job *) ctx)(worker); }, &job);
+    }
+
+    static uint32_t getHardwareThreads();
+
+private:
+    using JobFn = void (*)(void *ctx, uint32_t worker);
+
+    std::vector<std::thread> workers;
+    JobFn job = nullptr;
+    void *jobContext = nullptr;
+    alignas(64) std::atomic<uint64_t> generation{0};
+    alignas(64) std::atomic<uint32_t> pending{0};
+    std::atomic<uint32_t> sleeping{0};
+    std::atomic<bool> stopping{false};
+    std::mutex mutex;
+    std::condition_variable wake;
+
+    void dispatch(JobFn fn, void *ctx);
+
+    void workerLoop(uint32_t worker);
+};
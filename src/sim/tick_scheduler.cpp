@@ -0,0 +1,61 @@
+#include "tick_scheduler.hpp"
+#include <algorithm>
+
+static constexpr auto RATE_WINDOW = std::chrono::milliseconds(500);
+
+void TickScheduler::setMode(TickMode m) {
+    mode = m;
+    anchored = false;
+    windowStart = Clock::time_point();
+    windowTicks = 0;
+}
+
+void TickScheduler::setRate(double ticksPerSecond) {
+    rate = std::max(ticksPerSecond, 1e-3);
+    period = std::max<Clock::duration>(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate)),
+                                       Clock::duration(1));
+    anchored = false;
+    windowStart = Clock::time_point();
+    windowTicks = 0;
+}
+
+TickScheduler::Step TickScheduler::next(Clock::time_point now) {
+    if (mode == TickMode::TURBO)
+        return Step{batch, now, now};
+
+    if (!anchored) {
+        nextTick = now;
+        anchored = true;
+    }
+    if (now < nextTick)
+        return Step{0, nextTick - period, nextTick};
+
+    uint64_t due = (uint64_t) ((now - nextTick) / period) + 1;
+    uint64_t run = mode == TickMode::CATCH_UP ? std::min<uint64_t>(due, maxCatchUp) : 1;
+    if (due > run) {
+        // Too late : keep the phase of the schedule but forget what can't be caught up
+        dropped += due - run;
+        nextTick += period * (due - run);
+    }
+    Clock::time_point start = nextTick + period * (run - 1);
+    nextTick += period * run;
+    return Step{run, start, nextTick};
+}
+
+void TickScheduler::ticked(uint64_t ticks, Clock::duration took, Clock::time_point now) {
+    if (mode == TickMode::TURBO && ticks == batch) {
+        if (took < batchTime / 2)
+            batch *= 2;
+        else if (took > batchTime * 2 && batch > 1)
+            batch /= 2;
+    }
+
+    if (windowStart == Clock::time_point())
+        windowStart = now;
+    windowTicks += ticks;
+    if (now - windowStart >= RATE_WINDOW) {
+        achieved = (double) windowTicks / std::chrono::duration<double>(now - windowStart).count();
+        windowStart = now;
+        windowTicks = 0;
+    }
+}
@@ -0,0 +1,71 @@
+// Decides when ticks run and how many at once.
+//
+//   FIXED     one tick every period on an absolute schedule (no drift), missed ticks are dropped
+//   CATCH_UP  same schedule, but up to maxCatchUp missed ticks are run in a burst before dropping the rest
+//   TURBO     no schedule, batches sized to take about batchTime so the caller still polls regularly
+//
+// The caller sleeps until Step::wakeUp between steps, nothing spins.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+enum class TickMode {
+    FIXED,
+    CATCH_UP,
+    TURBO
+};
+
+class TickScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Step {
+        uint64_t ticks;           // to run now
+        Clock::time_point start;  // scheduled start of the last of them
+        Clock::time_point wakeUp; // next call
+    };
+
+    void setMode(TickMode m);
+
+    TickMode getMode() const { return mode; }
+
+    void setRate(double ticksPerSecond);
+
+    double getRate() const { return rate; }
+
+    Clock::duration getPeriod() const { return period; }
+
+    void setMaxCatchUp(uint32_t ticks) { maxCatchUp = ticks ? ticks : 1; }
+
+    // Start the schedule over from the next call, ticks run meanwhile (see SimulationThread::advance) are not owed.
+    void restart() { anchored = false; }
+
+    Step next(Clock::time_point now);
+
+    // Report ticks actually run and the time they took, for turbo batch sizing & statistics.
+    void ticked(uint64_t ticks, Clock::duration took, Clock::time_point now);
+
+    // Measured over the last half second or so.
+    double getAchievedRate() const { return achieved; }
+
+    // Ticks dropped because the simulation could not keep up.
+    uint64_t getDroppedTicks() const { return dropped; }
+
+private:
+    TickMode mode = TickMode::FIXED;
+    double rate = 1;
+    Clock::duration period = std::chrono::seconds(1);
+    uint32_t maxCatchUp = 64;
+    Clock::duration batchTime = std::chrono::milliseconds(2);
+
+    bool anchored = false;
+    Clock::time_point nextTick;
+    uint64_t batch = 1;
+    uint64_t dropped = 0;
+
+    Clock::time_point windowStart;
+    uint64_t windowTicks = 0;
+    double achieved = 0;
+};
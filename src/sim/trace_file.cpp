@@ -0,0 +1,279 @@
+#include "trace_file.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if PLATFORM_LINUX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif PLATFORM_WINDOWS
+#include <windows.h>
+#endif
+
+static const char TRACE_MAGIC[8] = "BBTRACE";
+static constexpr uint32_t TRACE_VERSION = 1;
+
+static void putVarint(std::vector<uint8_t> &bytes, uint64_t value) {
+    while (value >= 0x80) {
+        bytes.push_back((uint8_t) (value | 0x80));
+        value >>= 7;
+    }
+    bytes.push_back((uint8_t) value);
+}
+
+static uint64_t getVarint(const uint8_t *&p) {
+    uint64_t value = 0;
+    int shift = 0;
+    while (*p & 0x80) {
+        value |= (uint64_t) (*p++ & 0x7F) << shift;
+        shift += 7;
+    }
+    return value | (uint64_t) *p++ << shift;
+}
+
+// ---- Writer ----
+
+void TraceFileWriter::writeHeader() {
+    TraceFileHeader header{};
+    std::memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.signalCount = (uint32_t) names.size();
+    std::fwrite(&header, sizeof(header), 1, file);
+    offset = sizeof(header);
+    for (const string &name: names) {
+        uint32_t length = (uint32_t) name.size();
+        std::fwrite(&length, sizeof(length), 1, file);
+        std::fwrite(name.data(), 1, length, file);
+        offset += sizeof(length) + length;
+    }
+    columns.assign(names.size(), Column{});
+    lastChange = 0;
+}
+
+void TraceFileWriter::writeBlock(Column &column) {
+    TraceBlockEntry entry{};
+    entry.firstTick = column.firstTick;
+    entry.offset = offset;
+    entry.bytes = (uint32_t) column.bytes.size();
+    entry.count = column.count;
+    entry.firstValue = column.firstValue;
+    column.blocks.push_back(entry);
+    std::fwrite(column.bytes.data(), 1, column.bytes.size(), file);
+    offset += column.bytes.size();
+    column.bytes.clear();
+    column.count = 0;
+}
+
+void TraceFileWriter::writeChanges(const Chunk &changes) {
+    for (const Change &c: changes) {
+        Column &column = columns[c.signal];
+        if (column.count == 0) {
+            column.firstTick = c.tick;
+            column.firstValue = c.value;
+        } else
+            putVarint(column.bytes, c.tick - column.previous);
+        column.previous = c.tick;
+        column.count++;
+        column.changeCount++;
+        if (column.count == BLOCK_CHANGES)
+            writeBlock(column);
+        lastChange = c.tick;
+    }
+}
+
+void TraceFileWriter::writeEnd() {
+    for (Column &column: columns)
+        if (column.count)
+            writeBlock(column);
+
+    TraceFileHeader header{};
+    std::memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.signalCount = (uint32_t) columns.size();
+    header.firstTick = getFirstSampledTick();
+    header.lastTick = std::max(getLastSampledTick(), lastChange);
+    header.indexOffset = offset;
+
+    uint64_t firstBlock = 0;
+    for (const Column &column: columns) {
+        TraceSignalEntry entry{firstBlock, column.blocks.size(), column.changeCount};
+        std::fwrite(&entry, sizeof(entry), 1, file);
+        firstBlock += column.blocks.size();
+    }
+    for (const Column &column: columns)
+        std::fwrite(column.blocks.data(), sizeof(TraceBlockEntry), column.blocks.size(), file);
+    header.blockCount = firstBlock;
+
+    // The header goes last : a file with a 0 index offset is known to be incomplete
+    std::fseek(file, 0, SEEK_SET);
+    std::fwrite(&header, sizeof(header), 1, file);
+    columns.clear();
+}
+
+// ---- Reader ----
+
+TraceFile::~TraceFile() {
+    close();
+}
+
+bool TraceFile::open(const string &path) {
+    close();
+#if PLATFORM_LINUX
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOGERROR("Can't open trace file : {}", path);
+        return false;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void *mapped = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            data = (const uint8_t *) mapped;
+            size = (size_t) st.st_size;
+        }
+    }
+    ::close(fd);
+#elif PLATFORM_WINDOWS
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        LOGERROR("Can't open trace file : {}", path);
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    fileHandle = handle;
+    if (GetFileSizeEx(handle, &fileSize) && fileSize.QuadPart > 0) {
+        mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+            data = (const uint8_t *) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            size = data ? (size_t) fileSize.QuadPart : 0;
+        }
+    }
+#endif
+    if (!data) {
+        LOGERROR("Can't map trace file : {}", path);
+        close();
+        return false;
+    }
+
+    if (size < sizeof(header)) {
+        LOGERROR("Not a trace file : {}", path);
+        close();
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 || header.version != TRACE_VERSION) {
+        LOGERROR("Not a trace file : {}", path);
+        close();
+        return false;
+    }
+    uint64_t indexBytes = header.signalCount * sizeof(TraceSignalEntry) + header.blockCount * sizeof(TraceBlockEntry);
+    if (header.indexOffset == 0 || header.indexOffset > size || size - header.indexOffset < indexBytes) {
+        LOGERROR("Incomplete trace file : {}", path);
+        close();
+        return false;
+    }
+
+    const uint8_t *p = data + sizeof(header);
+    for (uint32_t i = 0; i < header.signalCount; i++) {
+        uint32_t length;
+        if (p + sizeof(length) > data + header.indexOffset) {
+            LOGERROR("Incomplete trace file : {}", path);
+            close();
+            return false;
+        }
+        std::memcpy(&length, p, sizeof(length));
+        p += sizeof(length);
+        names.emplace_back((const char *) p, std::min<size_t>(length, data + header.indexOffset - p));
+        p += length;
+    }
+    signalTable = data + header.indexOffset;
+    blockTable = signalTable + header.signalCount * sizeof(TraceSignalEntry);
+    return true;
+}
+
+void TraceFile::close() {
+#if PLATFORM_LINUX
+    if (data)
+        munmap((void *) data, size);
+#elif PLATFORM_WINDOWS
+    if (data)
+        UnmapViewOfFile(data);
+    if (mapping)
+        CloseHandle(mapping);
+    if (fileHandle)
+        CloseHandle(fileHandle);
+    mapping = fileHandle = nullptr;
+#endif
+    data = nullptr;
+    size = 0;
+    header = TraceFileHeader{};
+    names.clear();
+}
+
+TraceSignalEntry TraceFile::signalEntry(uint32_t signal) const {
+    TraceSignalEntry entry;
+    std::memcpy(&entry, signalTable + signal * sizeof(TraceSignalEntry), sizeof(entry));
+    return entry;
+}
+
+TraceBlockEntry TraceFile::blockEntry(uint64_t block) const {
+    TraceBlockEntry entry;
+    std::memcpy(&entry, blockTable + block * sizeof(TraceBlockEntry), sizeof(entry));
+    return entry;
+}
+
+uint64_t TraceFile::findBlock(const TraceSignalEntry &signal, uint64_t tick) const {
+    uint64_t low = 0, high = signal.blockCount; // first block starting after tick
+    while (low < high) {
+        uint64_t mid = (low + high) / 2;
+        if (blockEntry(signal.firstBlock + mid).firstTick <= tick)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return signal.firstBlock + (low ? low - 1 : 0);
+}
+
+bool TraceFile::valueAt(uint32_t signal, uint64_t tick) const {
+    std::vector<uint64_t> none;
+    return changesBetween(signal, tick, tick, none);
+}
+
+bool TraceFile::changesBetween(uint32_t signal, uint64_t from, uint64_t to, std::vector<uint64_t> &ticks) const {
+    TraceSignalEntry entry = signalEntry(signal);
+    if (!entry.blockCount)
+        return false;
+    bool value = false;
+    bool atFrom = false;
+    uint64_t first = findBlock(entry, from);
+    for (uint64_t b = first; b < entry.firstBlock + entry.blockCount; b++) {
+        TraceBlockEntry block = blockEntry(b);
+        // The first block decoded starts at or before `from`, or is the signal's first one
+        if (b == first)
+            value = atFrom = block.firstValue;
+        else if (block.firstTick > to)
+            break;
+        else {
+            value = !value;
+            if (block.firstTick > from)
+                ticks.push_back(block.firstTick);
+            else
+                atFrom = value;
+        }
+        const uint8_t *p = data + block.offset;
+        uint64_t tick = block.firstTick;
+        for (uint32_t k = 1; k < block.count; k++) {
+            tick += getVarint(p);
+            if (tick > to)
+                return atFrom;
+            value = !value;
+            if (tick > from)
+                ticks.push_back(tick);
+            else
+                atFrom = value;
+        }
+    }
+    return atFrom;
+}
@@ -0,0 +1,130 @@
+// Native binary traces (.bbt) : a column of change ticks per signal, readable without loading the file.
+//
+// Every probed pin only ever toggles after its first sample, so a signal is its first value plus the ticks where
+// it changes. Ticks are stored in blocks of up to BLOCK_CHANGES, as LEB128 varint deltas from the previous change.
+// An index at the end of the file lists each signal's blocks with their first tick : finding the value of any
+// signal at any tick is a binary search over blocks plus decoding a single block.
+//
+//   header    magic "BBTRACE", version, signal count, first & last ticks, index offset, block count
+//   names     per signal : uint32 length + bytes
+//   blocks    varint deltas, blocks of different signals interleaved in the order they filled up
+//   index     TraceSignalEntry per signal, then TraceBlockEntry per block grouped by signal
+//
+// Everything is little-endian. The index offset stays 0 until the writer closed the file.
+
+#pragma once
+
+#include "trace_writer.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct TraceFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t signalCount;
+    uint64_t firstTick;
+    uint64_t lastTick;
+    uint64_t indexOffset;
+    uint64_t blockCount;
+};
+
+struct TraceSignalEntry {
+    uint64_t firstBlock;
+    uint64_t blockCount;
+    uint64_t changeCount;
+};
+
+struct TraceBlockEntry {
+    uint64_t firstTick; // first change of the block
+    uint64_t offset;
+    uint32_t bytes;
+    uint32_t count;     // changes, the first one is firstTick itself
+    uint8_t firstValue; // after the first change
+    uint8_t padding[7];
+};
+
+class TraceFileWriter : public TraceWriter {
+public:
+    static constexpr uint32_t BLOCK_CHANGES = 4096;
+
+    ~TraceFileWriter() override { close(); }
+
+protected:
+    void writeHeader() override;
+
+    void writeChanges(const Chunk &changes) override;
+
+    void writeEnd() override;
+
+private:
+    // Block being filled, per signal
+    struct Column {
+        std::vector<uint8_t> bytes;
+        uint64_t firstTick = 0;
+        uint64_t previous = 0;
+        uint32_t count = 0;
+        uint8_t firstValue = 0;
+        uint64_t changeCount = 0;
+        std::vector<TraceBlockEntry> blocks;
+    };
+
+    std::vector<Column> columns;
+    uint64_t offset = 0;
+    uint64_t lastChange = 0;
+
+    void writeBlock(Column &column);
+};
+
+// Memory mapped reader, pages are only touched by the blocks actually decoded.
+class TraceFile {
+public:
+    TraceFile() = default;
+
+    ~TraceFile();
+
+    TraceFile(const TraceFile &) = delete;
+
+    TraceFile &operator=(const TraceFile &) = delete;
+
+    bool open(const string &path);
+
+    void close();
+
+    bool isOpen() const { return data != nullptr; }
+
+    uint32_t getSignalCount() const { return header.signalCount; }
+
+    const string &getSignalName(uint32_t signal) const { return names[signal]; }
+
+    uint64_t getFirstTick() const { return header.firstTick; }
+
+    uint64_t getLastTick() const { return header.lastTick; }
+
+    uint64_t getChangeCount(uint32_t signal) const { return signalEntry(signal).changeCount; }
+
+    // Before its first change a signal reads as its first value.
+    bool valueAt(uint32_t signal, uint64_t tick) const;
+
+    // Value at `from`, and the ticks in (from, to] where it toggles appended to `ticks`.
+    bool changesBetween(uint32_t signal, uint64_t from, uint64_t to, std::vector<uint64_t> &ticks) const;
+
+private:
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    TraceFileHeader header{};
+    std::vector<string> names;
+    const uint8_t *signalTable = nullptr;
+    const uint8_t *blockTable = nullptr;
+#if PLATFORM_WINDOWS
+    void *fileHandle = nullptr;
+    void *mapping = nullptr;
+#endif
+
+    TraceSignalEntry signalEntry(uint32_t signal) const;
+
+    TraceBlockEntry blockEntry(uint64_t block) const;
+
+    // Last block of the signal starting at or before `tick`, the first one when none does.
+    uint64_t findBlock(const TraceSignalEntry &signal, uint64_t tick) const;
+};
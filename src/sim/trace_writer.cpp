@@ -0,0 +1,95 @@
+#include "trace_writer.hpp"
+#include <chrono>
+
+bool TraceWriter::open(const string &path, const std::vector<string> &signalNames) {
+    close();
+    if (!path.empty() && !(file = std::fopen(path.c_str(), "wb"))) {
+        LOGERROR("Can't write trace file : {}", path);
+        return false;
+    }
+    names = signalNames;
+    writeHeader();
+
+    values.assign(names.size(), 2);
+    chunk.clear();
+    chunk.reserve(CHUNK_SIZE);
+    changeCount = 0;
+    sampled = false;
+    firstSampled = lastSampled = 0;
+    stopping = false;
+    thread = std::thread(&TraceWriter::run, this);
+    opened = true;
+    return true;
+}
+
+void TraceWriter::close() {
+    if (!opened)
+        return;
+    flush();
+    stopping = true;
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        wake.notify_one();
+    }
+    thread.join();
+    if (file)
+        std::fclose(file);
+    file = nullptr;
+    opened = false;
+}
+
+void TraceWriter::sample(uint64_t tick, const uint8_t *pins, const uint32_t *signalPins) {
+    if (sampled && tick <= lastSampled)
+        return;
+    if (!sampled)
+        firstSampled = tick;
+    sampled = true;
+    lastSampled = tick;
+    for (uint32_t i = 0; i < values.size(); i++) {
+        if (signalPins[i] == NO_PIN)
+            continue;
+        uint8_t v = pins[signalPins[i]];
+        if (v == values[i])
+            continue;
+        values[i] = v;
+        chunk.push_back(Change{tick, i, v});
+        if (chunk.size() == CHUNK_SIZE)
+            flush();
+    }
+}
+
+void TraceWriter::flush() {
+    if (chunk.empty())
+        return;
+    changeCount += chunk.size();
+    while (!full.push(std::move(chunk)))
+        std::this_thread::yield(); // the writer is behind, wait rather than lose changes
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        wake.notify_one();
+    }
+    if (!spare.pop(chunk))
+        chunk = Chunk();
+    chunk.clear();
+    chunk.reserve(CHUNK_SIZE);
+}
+
+void TraceWriter::run() {
+    Chunk changes;
+    while (true) {
+        if (full.pop(changes)) {
+            writeChanges(changes);
+            changes.clear();
+            spare.push(std::move(changes)); // dropped when the simulation thread already has enough
+            changes = Chunk();
+            continue;
+        }
+        if (stopping)
+            break;
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        wake.wait_for(lock, std::chrono::milliseconds(50), [this] { return !full.empty() || stopping; });
+    }
+    writeEnd();
+    if (file)
+        std::fflush(file);
+}
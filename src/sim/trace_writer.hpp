@@ -0,0 +1,98 @@
+// Value changes of probed pins, written to a file by a background thread. Subclasses pick the file format.
+//
+// The simulation thread only compares probed pins with their previous values and appends the changes to a chunk,
+// full chunks go through a lock-free queue to the writer thread. Emptied chunks come back through a second queue
+// so the tick loop doesn't allocate.
+
+#pragma once
+
+#include "core/defines.hpp"
+#include "spsc_queue.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class TraceWriter {
+public:
+    static constexpr uint32_t NO_PIN = UINT32_MAX;
+
+    TraceWriter() = default;
+
+    // Subclasses close() in their own destructor, the writer thread calls their methods.
+    virtual ~TraceWriter() = default;
+
+    TraceWriter(const TraceWriter &) = delete;
+
+    TraceWriter &operator=(const TraceWriter &) = delete;
+
+    // Write the header declaring one signal per name and start the writer thread. An empty path opens no file,
+    // for subclasses keeping the changes in memory.
+    bool open(const string &path, const std::vector<string> &signalNames);
+
+    // Write what is queued, then close the file.
+    void close();
+
+    bool isOpen() const { return opened; }
+
+    uint32_t getSignalCount() const { return (uint32_t) names.size(); }
+
+    // ---- Simulation thread ----
+
+    // State after `tick`, `signalPins[i]` is the pin of signal i or NO_PIN while it is not in the netlist.
+    // Ticks not after the last sampled one (replayed after a seek) are ignored, the file only goes forward.
+    void sample(uint64_t tick, const uint8_t *pins, const uint32_t *signalPins);
+
+    // Hand the pending changes to the writer thread without waiting for a full chunk.
+    void flush();
+
+    uint64_t getChangeCount() const { return changeCount; }
+
+protected:
+    struct Change {
+        uint64_t tick;
+        uint32_t signal;
+        uint8_t value;
+    };
+    using Chunk = std::vector<Change>;
+
+    FILE *file = nullptr; // null when opened without a path
+    std::vector<string> names;
+
+    // Caller thread, from open()
+    virtual void writeHeader() = 0;
+
+    // Writer thread, changes come in tick order
+    virtual void writeChanges(const Chunk &changes) = 0;
+
+    // Writer thread, after the last changes
+    virtual void writeEnd() = 0;
+
+    // First & last sampled ticks, complete once writeEnd() is called.
+    uint64_t getFirstSampledTick() const { return firstSampled; }
+
+    uint64_t getLastSampledTick() const { return lastSampled; }
+
+private:
+    static constexpr size_t CHUNK_SIZE = 8192;
+
+    bool opened = false;
+    std::vector<uint8_t> values; // last sampled, 2 before the first sample
+    Chunk chunk;
+    uint64_t changeCount = 0;
+    uint64_t firstSampled = 0;
+    uint64_t lastSampled = 0;
+    bool sampled = false;
+
+    SpscQueue<Chunk> full{64};
+    SpscQueue<Chunk> spare{64};
+    std::atomic<bool> stopping{false};
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    std::thread thread;
+
+    void run();
+};
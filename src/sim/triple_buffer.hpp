@@ -0,0 +1,38 @@
+// Hands the latest value from one writer thread to one reader thread without locks or waiting.
+// The writer fills its own buffer then swaps it with the shared one, the reader swaps the shared one with its own
+// when it is newer : neither side ever touches a buffer the other one is using.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+template<typename T>
+class TripleBuffer {
+public:
+    // Writer side : fill it, then publish().
+    T &back() { return buffers[backIndex]; }
+
+    void publish() {
+        backIndex = shared.exchange(backIndex | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Reader side : swap in the latest published value, false when nothing new was published.
+    bool update() {
+        if (!(shared.load(std::memory_order_relaxed) & FRESH))
+            return false;
+        frontIndex = shared.exchange(frontIndex, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    const T &front() const { return buffers[frontIndex]; }
+
+private:
+    static constexpr uint8_t INDEX = 3;
+    static constexpr uint8_t FRESH = 4;
+
+    T buffers[3];
+    uint8_t backIndex = 0;
+    uint8_t frontIndex = 1;
+    std::atomic<uint8_t> shared{2};
+};
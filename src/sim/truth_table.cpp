@@ -0,0 +1,111 @@
+#include "truth_table.hpp"
+#include "thread_pool.hpp"
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+
+namespace {
+
+// Words evaluated together, 512 rows
+constexpr uint32_t BLOCK = 8;
+
+// Rows of the first 6 inputs within a word
+constexpr uint64_t PATTERNS[6] = {0xAAAAAAAAAAAAAAAAull, 0xCCCCCCCCCCCCCCCCull, 0xF0F0F0F0F0F0F0F0ull,
+                                  0xFF00FF00FF00FF00ull, 0xFFFF0000FFFF0000ull, 0xFFFFFFFF00000000ull};
+
+uint64_t splitmix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+}
+
+string TruthTable::getHashText() const {
+    char text[17];
+    std::snprintf(text, sizeof(text), "%016llx", (unsigned long long) hash);
+    return text;
+}
+
+bool TruthTable::write(const string &path) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        LOGERROR("Can't write truth table : {}", path);
+        return false;
+    }
+    file << "# inputs " << inputCount << ", outputs " << outputCount << ", hash " << getHashText() << '\n';
+    string line(inputCount + 1 + outputCount + 1, ' ');
+    line.back() = '\n';
+    const uint64_t rows = 1ull << inputCount;
+    for (uint64_t row = 0; row < rows; row++) {
+        for (uint32_t i = 0; i < inputCount; i++)
+            line[i] = row >> i & 1 ? '1' : '0';
+        for (uint32_t k = 0; k < outputCount; k++)
+            line[inputCount + 1 + k] = get(row, k) ? '1' : '0';
+        file.write(line.data(), (std::streamsize) line.size());
+    }
+    return (bool) file;
+}
+
+bool buildTruthTable(const Aig &aig, TruthTable &table, uint32_t threads, bool keepColumns) {
+    if (aig.getLatchCount()) {
+        LOGERROR("Truth tables need loop free circuits, latches : {}", aig.getLatchCount());
+        return false;
+    }
+    if (aig.getInputCount() > TRUTH_TABLE_MAX_INPUTS) {
+        LOGERROR("Too many inputs for a truth table : {}", aig.getInputCount());
+        return false;
+    }
+    table.inputCount = aig.getInputCount();
+    table.outputCount = (uint32_t) aig.getOutputs().size();
+    table.hash = 0;
+    const uint32_t inputCount = table.inputCount, outputCount = table.outputCount;
+    const uint64_t words = table.getWordCount();
+    const uint64_t blocks = (words + BLOCK - 1) / BLOCK;
+    // Rows past 2^inputs when there are less than 6 inputs
+    const uint64_t rowMask = inputCount >= 6 ? ~0ull : (1ull << (1u << inputCount)) - 1;
+    table.columns.assign(keepColumns ? outputCount * words : 0, 0);
+
+    ThreadPool pool(threads ? threads : ThreadPool::getHardwareThreads());
+    const uint32_t threadCount = pool.getThreadCount();
+    const uint32_t base = 1 + inputCount;
+    const std::vector<Aig::And> &ands = aig.getAnds();
+    std::mutex mutex;
+    pool.run([&](uint32_t worker) {
+        std::vector<uint64_t> values((size_t) aig.getVariableCount() * BLOCK, 0);
+        auto word = [&](uint32_t literal) {
+            return &values[(size_t) (literal >> 1) * BLOCK];
+        };
+        uint64_t hash = 0;
+        for (uint64_t block = blocks * worker / threadCount; block < blocks * (worker + 1) / threadCount; block++) {
+            const uint64_t first = block * BLOCK;
+            for (uint32_t i = 0; i < inputCount; i++) {
+                uint64_t *in = word(aig.getInput(i));
+                for (uint32_t j = 0; j < BLOCK; j++)
+                    in[j] = i < 6 ? PATTERNS[i] : 0 - ((first + j) >> (i - 6) & 1);
+            }
+            for (size_t a = 0; a < ands.size(); a++) {
+                const uint64_t *x = word(ands[a].a), *y = word(ands[a].b);
+                const uint64_t flipX = 0 - (uint64_t) (ands[a].a & 1), flipY = 0 - (uint64_t) (ands[a].b & 1);
+                uint64_t *z = &values[(base + a) * BLOCK];
+                for (uint32_t j = 0; j < BLOCK; j++)
+                    z[j] = (x[j] ^ flipX) & (y[j] ^ flipY);
+            }
+            const uint32_t count = (uint32_t) std::min<uint64_t>(BLOCK, words - first);
+            for (uint32_t k = 0; k < outputCount; k++) {
+                const uint32_t literal = aig.getOutputs()[k];
+                const uint64_t *out = word(literal), flip = 0 - (uint64_t) (literal & 1);
+                for (uint32_t j = 0; j < count; j++) {
+                    const uint64_t index = k * words + first + j, value = (out[j] ^ flip) & rowMask;
+                    if (keepColumns)
+                        table.columns[index] = value;
+                    hash += splitmix(value ^ splitmix(index));
+                }
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        table.hash += hash;
+    });
+    return true;
+}
@@ -0,0 +1,36 @@
+// Exhaustive truth tables of loop free circuits, from their and-inverter graph (see sim/aig.hpp).
+//
+// Row r sets input i to bit i of r, so input 0 changes fastest. A word holds 64 consecutive rows : the first 6 inputs
+// are the same constant patterns in every word and the others are all zeros or all ones, so rows need no input
+// packing. Blocks of words are split across threads and every AND is evaluated over a whole block at once.
+
+#pragma once
+
+#include "aig.hpp"
+#include <vector>
+
+// Past that many inputs, only the hash is worth computing (the columns take 2^inputs / 8 bytes per output).
+constexpr uint32_t TRUTH_TABLE_MAX_INPUTS = 32;
+constexpr uint32_t TRUTH_TABLE_MAX_WRITTEN_INPUTS = 24;
+
+struct TruthTable {
+    uint32_t inputCount = 0;
+    uint32_t outputCount = 0;
+    uint64_t hash = 0;             // of every column, the same whatever the thread count
+    std::vector<uint64_t> columns; // per output, one bit per row, when kept
+
+    uint64_t getWordCount() const { return inputCount <= 6 ? 1 : 1ull << (inputCount - 6); }
+
+    bool get(uint64_t row, uint32_t output) const {
+        return columns[output * getWordCount() + (row >> 6)] >> (row & 63) & 1;
+    }
+
+    string getHashText() const;
+
+    // One line per row : the inputs then the outputs, in node order.
+    bool write(const string &path) const;
+};
+
+// False for circuits with loops or more than TRUTH_TABLE_MAX_INPUTS inputs. Without `keepColumns` only the hash is
+// computed.
+bool buildTruthTable(const Aig &aig, TruthTable &table, uint32_t threads = 0, bool keepColumns = true);
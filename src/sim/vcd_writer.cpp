@@ -0,0 +1,62 @@
+#include "vcd_writer.hpp"
+#include <charconv>
+
+static constexpr size_t WRITE_SIZE = 1 << 20;
+
+// Printable characters from '!' to '~', shortest first.
+static string identifierCode(uint32_t index) {
+    string code;
+    do {
+        code += (char) ('!' + index % 94);
+        index /= 94;
+    } while (index);
+    return code;
+}
+
+// Wire names can't hold whitespace.
+static string wireName(const string &name) {
+    string result = name.empty() ? "probe" : name;
+    for (char &c: result)
+        if (c == ' ' || c == '\t')
+            c = '_';
+    return result;
+}
+
+void VcdWriter::writeHeader() {
+    codes.clear();
+    string header = "$version BasicBool $end\n$timescale 1 ns $end\n$scope module circuit $end\n";
+    for (uint32_t i = 0; i < names.size(); i++) {
+        codes.push_back(identifierCode(i));
+        header += "$var wire 1 " + codes.back() + " " + wireName(names[i]) + " $end\n";
+    }
+    header += "$upscope $end\n$enddefinitions $end\n";
+    std::fwrite(header.data(), 1, header.size(), file);
+    buffer.clear();
+    buffer.reserve(2 * WRITE_SIZE);
+    lastTick = UINT64_MAX;
+}
+
+void VcdWriter::writeChanges(const Chunk &changes) {
+    char digits[24];
+    for (const Change &c: changes) {
+        if (c.tick != lastTick) {
+            lastTick = c.tick;
+            char *end = std::to_chars(digits, digits + sizeof(digits), c.tick).ptr;
+            buffer += '#';
+            buffer.append(digits, end);
+            buffer += '\n';
+        }
+        buffer += c.value ? '1' : '0';
+        buffer += codes[c.signal];
+        buffer += '\n';
+    }
+    if (buffer.size() >= WRITE_SIZE) {
+        std::fwrite(buffer.data(), 1, buffer.size(), file);
+        buffer.clear();
+    }
+}
+
+void VcdWriter::writeEnd() {
+    std::fwrite(buffer.data(), 1, buffer.size(), file);
+    buffer.clear();
+}
@@ -0,0 +1,22 @@
+// Value Change Dump of probed pins, readable by standard waveform viewers (one time unit per tick).
+
+#pragma once
+
+#include "trace_writer.hpp"
+
+class VcdWriter : public TraceWriter {
+public:
+    ~VcdWriter() override { close(); }
+
+protected:
+    void writeHeader() override;
+
+    void writeChanges(const Chunk &changes) override;
+
+    void writeEnd() override;
+
+private:
+    std::vector<string> codes; // identifier per signal
+    string buffer;
+    uint64_t lastTick = UINT64_MAX;
+};
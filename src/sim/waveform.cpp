@@ -0,0 +1,123 @@
+#include "waveform.hpp"
+#include <algorithm>
+
+static uint8_t merge(uint8_t a, uint8_t b) {
+    if (a == (uint8_t) WaveState::NONE)
+        return b;
+    if (b == (uint8_t) WaveState::NONE)
+        return a;
+    return a == b ? a : (uint8_t) WaveState::TOGGLING;
+}
+
+std::vector<string> WaveformRecorder::getSignalNames() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return signalNames;
+}
+
+void WaveformRecorder::writeHeader() {
+    std::lock_guard<std::mutex> lock(mutex);
+    signals.assign(names.size(), Signal{});
+    signalNames = names;
+}
+
+void WaveformRecorder::hold(Signal &s, uint64_t from, uint64_t to, uint8_t value) {
+    if (from >= to)
+        return;
+    for (size_t l = 0;; l++) {
+        if (l == s.levels.size()) {
+            // A new level starts as the summary of the one below
+            std::vector<uint8_t> level;
+            if (l > 0) {
+                const std::vector<uint8_t> &below = s.levels[l - 1];
+                level.assign((below.size() + 1) / 2, (uint8_t) WaveState::NONE);
+                for (size_t i = 0; i < below.size(); i++)
+                    level[i / 2] = merge(level[i / 2], below[i]);
+            }
+            s.levels.push_back(std::move(level));
+        }
+        std::vector<uint8_t> &level = s.levels[l];
+        uint64_t size = BASE_TICKS << l;
+        uint64_t first = from / size, last = (to - 1) / size;
+        if (level.size() <= last)
+            level.resize(last + 1, (uint8_t) WaveState::NONE);
+        for (uint64_t i = first; i <= last; i++)
+            level[i] = merge(level[i], value);
+        if (last == 0 && l + 1 == s.levels.size())
+            break; // a single bucket covers everything so far
+    }
+}
+
+void WaveformRecorder::writeChanges(const Chunk &changes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const Change &c: changes) {
+        Signal &s = signals[c.signal];
+        if (!s.started) {
+            s.started = true;
+            s.start = s.since = c.tick;
+            s.value = c.value;
+            continue;
+        }
+        hold(s, s.since, c.tick, s.value);
+        s.since = c.tick;
+        s.value = c.value;
+        if (s.changes.empty())
+            s.frontValue = c.value;
+        s.changes.push_back(c.tick);
+        if (s.changes.size() > MAX_CHANGES) {
+            s.changes.pop_front();
+            s.frontValue ^= 1;
+            s.trimmed = true;
+        }
+    }
+}
+
+WaveState WaveformRecorder::exactState(const Signal &s, uint64_t a, uint64_t b) {
+    auto next = std::upper_bound(s.changes.begin(), s.changes.end(), a); // first change after a
+    size_t k = next - s.changes.begin();
+    uint8_t value;
+    if (s.changes.empty())
+        value = s.value;
+    else if (k == 0)
+        value = s.frontValue ^ 1;
+    else
+        value = s.frontValue ^ ((k - 1) & 1);
+    if (next != s.changes.end() && *next < b)
+        return WaveState::TOGGLING;
+    return (WaveState) value;
+}
+
+WaveState WaveformRecorder::bucketState(const Signal &s, uint64_t a, uint64_t b) {
+    uint8_t state = (uint8_t) WaveState::NONE;
+    if (b > s.since)
+        state = s.value; // held since the last change, not in the buckets
+    if (a < s.since && !s.levels.empty()) {
+        uint64_t end = std::min(b, s.since);
+        size_t l = 0;
+        while (l + 1 < s.levels.size() && (BASE_TICKS << (l + 1)) <= end - a)
+            l++;
+        const std::vector<uint8_t> &level = s.levels[l];
+        uint64_t size = BASE_TICKS << l;
+        for (uint64_t i = a / size; i <= (end - 1) / size && i < level.size(); i++)
+            state = merge(state, level[i]);
+    }
+    return (WaveState) state;
+}
+
+void WaveformRecorder::summarize(uint32_t signal, uint64_t from, double ticksPerColumn, uint32_t columns,
+                                 uint64_t now, std::vector<WaveState> &states) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    states.assign(columns, WaveState::NONE);
+    if (signal >= signals.size() || !signals[signal].started)
+        return;
+    const Signal &s = signals[signal];
+    for (uint32_t c = 0; c < columns; c++) {
+        uint64_t a = from + (uint64_t) (c * ticksPerColumn);
+        uint64_t b = std::max(a + 1, from + (uint64_t) ((c + 1) * ticksPerColumn));
+        if (b <= s.start || a > now)
+            continue;
+        a = std::max(a, s.start);
+        b = std::min(b, now + 1);
+        bool exact = b - a < BASE_TICKS && (!s.trimmed || a >= s.changes.front());
+        states[c] = exact ? exactState(s, a, b) : bucketState(s, a, b);
+    }
+}
@@ -0,0 +1,63 @@
+// Live waveforms of probed signals, summarized so any time range draws with at most one primitive per pixel.
+//
+// Each signal keeps its recent change ticks exactly, plus a pyramid of buckets : level 0 buckets cover BASE_TICKS
+// ticks and each level above covers twice as many. A bucket only tells whether the signal stayed 0, stayed 1 or
+// toggled within it, so a pixel column spanning 10^8 ticks reads a couple of buckets. Changes arrive through the
+// TraceWriter thread, readers on other threads lock per query.
+
+#pragma once
+
+#include "trace_writer.hpp"
+#include <deque>
+#include <mutex>
+
+enum class WaveState : uint8_t {
+    ZERO,
+    ONE,
+    TOGGLING,
+    NONE // not sampled
+};
+
+class WaveformRecorder : public TraceWriter {
+public:
+    static constexpr uint64_t BASE_TICKS = 256;
+    static constexpr size_t MAX_CHANGES = 1 << 20; // exact ticks kept per signal
+
+    ~WaveformRecorder() override { close(); }
+
+    std::vector<string> getSignalNames() const;
+
+    // State of `signal` in `columns` columns of `ticksPerColumn` ticks from `from`, ticks after `now` are NONE.
+    void summarize(uint32_t signal, uint64_t from, double ticksPerColumn, uint32_t columns, uint64_t now,
+                   std::vector<WaveState> &states) const;
+
+protected:
+    void writeHeader() override;
+
+    void writeChanges(const Chunk &changes) override;
+
+    void writeEnd() override {}
+
+private:
+    struct Signal {
+        bool started = false;
+        uint64_t start = 0;  // first sample
+        uint8_t value = 0;   // held since `since`, not in the buckets yet
+        uint64_t since = 0;
+        std::deque<uint64_t> changes;
+        uint8_t frontValue = 0; // after changes.front()
+        bool trimmed = false;   // oldest changes dropped, only buckets before changes.front()
+        std::vector<std::vector<uint8_t>> levels;
+    };
+
+    mutable std::mutex mutex;
+    std::vector<Signal> signals;
+    std::vector<string> signalNames; // `names` belongs to the simulation thread
+
+    // Merge `value` into the buckets of [from, to)
+    static void hold(Signal &s, uint64_t from, uint64_t to, uint8_t value);
+
+    static WaveState exactState(const Signal &s, uint64_t a, uint64_t b);
+
+    static WaveState bucketState(const Signal &s, uint64_t a, uint64_t b);
+};